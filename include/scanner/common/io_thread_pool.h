@@ -24,6 +24,9 @@ public:
     // 返回负载最小的 io_context 引用（不跟踪任务）
     asio::io_context& get_context();
 
+    // 轮询返回 io_context，用于把大量短小的异步操作均匀分散到各 IO 线程
+    asio::io_context& next_context();
+
     // 返回带负载计数的执行器；使用该执行器的 post/dispatch 会自动维护负载
     class TrackingExecutor {
     public:
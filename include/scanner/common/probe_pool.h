@@ -0,0 +1,215 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace scanner {
+
+// =====================
+// 线程本地块池
+// =====================
+// 探测上下文、Asio 操作对象与接收缓冲按尺寸分级，从线程本地空闲链表取用，
+// 释放时回到当前线程的链表。探测通常在扫描线程创建、在 IO 线程销毁，
+// 因此线程缓存超过上限时整批归还到全局仓库，空缓存时整批取回，
+// 锁只在批量交换时获取一次。
+
+struct ProbePoolStats {
+    std::size_t allocations = 0;    // 本线程分配次数
+    std::size_t pool_hits = 0;      // 命中空闲链表（无需 operator new）的次数
+    std::size_t depot_refills = 0;  // 从全局仓库取回整批的次数
+};
+
+class ProbePool {
+public:
+    static constexpr std::size_t kMinBlock = 64;
+    static constexpr std::size_t kMaxBlock = 8192;
+    static constexpr std::size_t kClassCount = 8;   // 64 .. 8192
+    static constexpr std::size_t kBatch = 32;       // 与仓库交换的批大小
+    static constexpr std::size_t kLocalCap = 4 * kBatch;
+
+    static void* allocate(std::size_t bytes) {
+        auto& cache = local();
+        ++cache.stats.allocations;
+        if (bytes > kMaxBlock) {
+            return ::operator new(bytes);
+        }
+        std::size_t cls = size_class(bytes);
+        auto& list = cache.lists[cls];
+        if (!list.head && refill(cls, list)) {
+            ++cache.stats.depot_refills;
+        }
+        if (list.head) {
+            Block* b = list.head;
+            list.head = b->next;
+            --list.count;
+            ++cache.stats.pool_hits;
+            return b;
+        }
+        return ::operator new(class_size(cls));
+    }
+
+    static void deallocate(void* p, std::size_t bytes) noexcept {
+        if (!p) return;
+        if (bytes > kMaxBlock) {
+            ::operator delete(p);
+            return;
+        }
+        std::size_t cls = size_class(bytes);
+        auto& list = local().lists[cls];
+        auto* b = static_cast<Block*>(p);
+        b->next = list.head;
+        list.head = b;
+        if (++list.count > kLocalCap) {
+            spill(cls, list);
+        }
+    }
+
+    // 当前线程的统计
+    static ProbePoolStats stats() { return local().stats; }
+
+private:
+    struct Block {
+        Block* next;
+        Block* next_batch;  // 仅在仓库中使用：批与批之间的链接
+    };
+
+    struct FreeList {
+        Block* head = nullptr;
+        std::size_t count = 0;
+    };
+
+    struct LocalCache {
+        std::array<FreeList, kClassCount> lists{};
+        ProbePoolStats stats;
+
+        ~LocalCache() {
+            // 线程退出时把缓存整批归还仓库，供其他线程继续复用
+            for (std::size_t cls = 0; cls < kClassCount; ++cls) {
+                while (lists[cls].count > 0) {
+                    spill(cls, lists[cls]);
+                }
+            }
+        }
+    };
+
+    struct Depot {
+        std::mutex mutex;
+        std::array<Block*, kClassCount> batches{};
+    };
+
+    static LocalCache& local() {
+        thread_local LocalCache cache;
+        return cache;
+    }
+
+    static Depot& depot() {
+        static Depot* d = new Depot();  // 不析构：线程退出顺序晚于静态对象时仍可用
+        return *d;
+    }
+
+    static std::size_t class_size(std::size_t cls) { return kMinBlock << cls; }
+
+    static std::size_t size_class(std::size_t bytes) {
+        std::size_t cls = 0;
+        while (class_size(cls) < bytes) ++cls;
+        return cls;
+    }
+
+    // 从本地链表头部摘下至多 kBatch 个块，作为一批挂入仓库
+    static void spill(std::size_t cls, FreeList& list) {
+        Block* batch = list.head;
+        Block* tail = batch;
+        std::size_t n = 1;
+        while (n < kBatch && tail->next) {
+            tail = tail->next;
+            ++n;
+        }
+        list.head = tail->next;
+        list.count -= n;
+        tail->next = nullptr;
+
+        auto& d = depot();
+        std::lock_guard<std::mutex> lock(d.mutex);
+        batch->next_batch = d.batches[cls];
+        d.batches[cls] = batch;
+    }
+
+    static bool refill(std::size_t cls, FreeList& list) {
+        auto& d = depot();
+        Block* batch = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(d.mutex);
+            batch = d.batches[cls];
+            if (batch) d.batches[cls] = batch->next_batch;
+        }
+        if (!batch) return false;
+        std::size_t n = 0;
+        for (Block* b = batch; b; b = b->next) ++n;
+        list.head = batch;
+        list.count = n;
+        return true;
+    }
+
+    static_assert(sizeof(Block) <= kMinBlock, "block header must fit the smallest class");
+};
+
+// 供 allocate_shared / Asio 关联分配器使用的标准分配器
+template <typename T>
+class ProbeAllocator {
+public:
+    using value_type = T;
+
+    ProbeAllocator() noexcept = default;
+    template <typename U>
+    ProbeAllocator(const ProbeAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                      "over-aligned types are not supported by ProbePool");
+        return static_cast<T*>(ProbePool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        ProbePool::deallocate(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const ProbeAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const ProbeAllocator<U>&) const noexcept { return false; }
+};
+
+// =====================
+// 池化完成处理器
+// =====================
+// 通过关联分配器让 Asio 的操作对象（connect/read/write/wait）从 ProbePool 分配，
+// 而不是走 operator new。
+
+template <typename Handler>
+class PooledHandler {
+public:
+    using allocator_type = ProbeAllocator<void>;
+
+    explicit PooledHandler(Handler handler) : handler_(std::move(handler)) {}
+
+    allocator_type get_allocator() const noexcept { return allocator_type(); }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+        handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    Handler handler_;
+};
+
+template <typename Handler>
+PooledHandler<std::decay_t<Handler>> pooled(Handler&& handler) {
+    return PooledHandler<std::decay_t<Handler>>(std::forward<Handler>(handler));
+}
+
+} // namespace scanner
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace scanner {
+
+// =====================
+// SipHash-2-4
+// =====================
+// 带 128 位密钥的短输入 PRF，用于无状态扫描的 Cookie：
+// 密钥每次运行随机生成，对端无法预测，也无法伪造与本机发出的探测相匹配的回包。
+
+struct SipKey {
+    std::uint64_t k0 = 0;
+    std::uint64_t k1 = 0;
+};
+
+namespace detail {
+
+inline std::uint64_t rotl64(std::uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+inline void sip_round(std::uint64_t& v0, std::uint64_t& v1, std::uint64_t& v2, std::uint64_t& v3) {
+    v0 += v1; v1 = rotl64(v1, 13); v1 ^= v0; v0 = rotl64(v0, 32);
+    v2 += v3; v3 = rotl64(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl64(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl64(v1, 17); v1 ^= v2; v2 = rotl64(v2, 32);
+}
+
+inline std::uint64_t load_le64(const unsigned char* p) {
+    std::uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+} // namespace detail
+
+inline std::uint64_t siphash24(const SipKey& key, const void* data, std::size_t len) {
+    using detail::sip_round;
+    std::uint64_t v0 = 0x736f6d6570736575ULL ^ key.k0;
+    std::uint64_t v1 = 0x646f72616e646f6dULL ^ key.k1;
+    std::uint64_t v2 = 0x6c7967656e657261ULL ^ key.k0;
+    std::uint64_t v3 = 0x7465646279746573ULL ^ key.k1;
+
+    const auto* in = static_cast<const unsigned char*>(data);
+    const std::size_t full = len & ~std::size_t(7);
+    for (std::size_t i = 0; i < full; i += 8) {
+        std::uint64_t m = detail::load_le64(in + i);
+        v3 ^= m;
+        sip_round(v0, v1, v2, v3);
+        sip_round(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    // 末尾不足 8 字节的部分与长度（低 8 位）拼成最后一个分组
+    std::uint64_t b = static_cast<std::uint64_t>(len) << 56;
+    for (std::size_t i = 0; i < (len & 7); ++i) {
+        b |= static_cast<std::uint64_t>(in[full + i]) << (8 * i);
+    }
+    v3 ^= b;
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+} // namespace scanner
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "scanner/protocols/protocol_base.h"
+#include "scanner/dns/dns_resolver.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scanner {
+
+// =====================
+// DNS 前瞻预取
+// =====================
+// 在准入点（创建 ScanSession）之前 N 个位置提前解析目标，
+// 使探测槽位空出时队首几乎总有已解析好的目标可用。
+// N 按 Little 定律估算：窗口 ≈ 准入速率 × DNS 平均时延 × 余量，
+// 并钳制在 [min_window, max_window] 之间。
+
+// 已完成预取的目标
+struct PrefetchedTarget {
+    ScanTarget target;
+    DnsResult dns;
+    bool prefetched = false;  // 是否经过 DNS 预取（IP 直连目标为 false）
+};
+
+class DnsPrefetcher {
+public:
+    struct Stats {
+        size_t hits = 0;             // 准入时已有解析完成的目标
+        size_t misses = 0;           // 准入时目标仍在解析中（需要等待）
+        size_t resolved = 0;         // 解析成功数
+        size_t failed = 0;           // 解析失败数
+        double avg_dns_ms = 0.0;     // DNS 平滑时延
+        double admission_rate = 0.0; // 平滑准入速率（个/秒）
+        size_t window = 0;           // 当前前瞻窗口大小
+    };
+
+    DnsPrefetcher(size_t workers, Timeout dns_timeout, size_t min_window, size_t max_window);
+    ~DnsPrefetcher();
+
+    DnsPrefetcher(const DnsPrefetcher&) = delete;
+    DnsPrefetcher& operator=(const DnsPrefetcher&) = delete;
+
+    // 当前建议的前瞻窗口大小
+    size_t window() const;
+
+    // 窗口内目标数（解析中 + 已就绪）
+    size_t in_window() const;
+
+    // 窗口是否为空（没有解析中或就绪的目标）
+    bool empty() const { return in_window() == 0; }
+
+    // 将目标放入前瞻窗口；已带 IP 的目标直接就绪
+    void submit(ScanTarget target);
+
+    // 准入点取出一个就绪目标；返回 false 表示暂无可用目标
+    bool try_take(PrefetchedTarget& out);
+
+    Stats stats() const;
+
+    // 停止工作线程（丢弃未完成的解析）
+    void shutdown();
+
+private:
+    void worker_loop();
+    void record_admission();
+
+    Timeout dns_timeout_;
+    size_t min_window_;
+    size_t max_window_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<ScanTarget> pending_;          // 待解析
+    std::deque<PrefetchedTarget> ready_;      // 已就绪（FIFO）
+    size_t resolving_ = 0;                    // 正在解析
+    bool stop_ = false;
+    bool stalled_ = false;                    // 当前是否处于等待 DNS 的停顿中
+
+    // 统计
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    size_t resolved_ = 0;
+    size_t failed_ = 0;
+    double dns_ewma_ms_ = 0.0;
+    double rate_ewma_ = 0.0;
+    size_t admissions_in_period_ = 0;
+    std::chrono::steady_clock::time_point period_start_;
+
+    std::vector<std::thread> workers_;
+};
+
+} // namespace scanner
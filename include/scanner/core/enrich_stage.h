@@ -0,0 +1,60 @@
+#pragma once
+
+#include "scanner/protocols/protocol_base.h"
+#include "scanner/common/thread_pool.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace scanner {
+
+class ScanSession;
+
+// =====================
+// 结果后处理阶段（CPU）
+// =====================
+// IO 线程上的探测只做 socket 收发与决定对话走向所需的解析；证书解析、HASSH、HTTP 特征搜索、
+// 动态超时统计与结果入队都交到这里，在 CPU 线程池上完成（见 ScanSession::finish_result）。
+// IO 线程每次只在锁内追加一项，队列由空变非空时才向线程池提交一次排空任务；
+// 每次唤醒至多处理 kMaxBatch 项，积压超过一批时先再提交一次，空闲的 CPU 线程并行处理后续批次。
+// 交接延迟只取决于线程池排队，不随积压的结果数增长。
+
+class EnrichStage {
+public:
+    static constexpr std::size_t kMaxBatch = 64;
+
+    struct Stats {
+        size_t items = 0;     // 处理的结果数
+        size_t batches = 0;   // 唤醒（排空任务）次数
+    };
+
+    explicit EnrichStage(ThreadPool& pool) : pool_(pool) {}
+
+    EnrichStage(const EnrichStage&) = delete;
+    EnrichStage& operator=(const EnrichStage&) = delete;
+
+    // 交接一条结果，proto 为产生结果的协议（可为空）；线程池已停止时在调用线程上就地完成
+    void post(ScanSession* session, const IProtocol* proto, ProtocolResult&& result);
+
+    Stats stats() const;
+
+private:
+    struct Item {
+        ScanSession* session;
+        const IProtocol* proto;
+        ProtocolResult result;
+    };
+
+    void schedule();
+    void drain();
+
+    ThreadPool& pool_;
+    std::mutex mutex_;
+    std::vector<Item> pending_;
+    bool scheduled_ = false;   // 已有排空任务在线程池中排队或运行
+
+    std::atomic<size_t> items_{0};
+    std::atomic<size_t> batches_{0};
+};
+
+} // namespace scanner
@@ -48,11 +48,52 @@ struct ScannerConfig {
     bool enable_telnet = false;
     bool enable_ssh = true;
     bool scan_all_ports = false;
+    bool optimistic_commands = false;   // SMTP/POP3/IMAP/FTP 连接后立即写出 EHLO/CAPA/CAPABILITY/FEAT，不等欢迎消息
+    // 非默认端口上服务端先发言的协议空闲这么久仍无欢迎消息就催促一次，再空闲同样时长即结束；0 表示等到超时
+    std::chrono::milliseconds idle_nudge = std::chrono::milliseconds(2000);
+    std::string idle_nudge_payload = "http";   // 催促内容：http（GET / HTTP/1.0）或 crlf
+    // 接收速率下限（字节/秒，0 表示不检查）：统计窗口内分段到达且平均低于此值的连接判为滴灌并提前结束
+    size_t min_recv_rate = 32;
+    std::chrono::milliseconds recv_rate_window = std::chrono::milliseconds(2000);
+    // tarpit 判定：预扫附带金丝雀端口、比对各端口应答指纹，判定后取消该主机剩余探测
+    bool tarpit_detection = true;
+
+    // 端口预扫配置（只建连接的存活预扫，只把开放端口交给协议探测）
+    bool port_prepass = true;
+    std::chrono::milliseconds port_prepass_timeout = std::chrono::milliseconds(0);  // 0 表示沿用探测超时
+    size_t port_prepass_max_inflight = 4096;   // 同时进行的连接尝试上限
+    size_t port_prepass_rate = 0;              // 每秒连接尝试上限，0 表示不限
+    bool port_prepass_syn = false;             // 使用原始套接字 SYN 扫描（需要 CAP_NET_RAW，不可用时回退）
+    size_t port_prepass_syn_retries = 1;       // SYN 无应答时的重发次数
+
+    // 脚本探测定义文件（见 probe_script.h），其中 enabled 的定义或 --protocols 点名的定义参与扫描
+    std::string probe_definition_file = "./config/probes.json";
+
+    // 服务识别（nmap-service-probes 格式的探测库，见 service_probes.h）
+    bool enable_service = false;
+    std::string service_probe_file = "./config/service-probes";
+    std::vector<Port> service_ports;           // 为空时取探测库中 ports / sslports 的并集
+    int service_intensity = 7;                 // 只发送 rarity 不超过该值的探测
+    size_t service_max_probes = 3;             // 每个端口最多依次尝试的探测数
+
+    // UDP 探测（DNS / NTP / NTP_PRIVATE / SNMP / SSDP，见 udp_protocols.h），--protocols 未给出时按此列表启用
+    std::vector<std::string> udp_protocols;
+
+    // HTTP 在同一连接上流水线发送的请求（"方法 路径" 或只写路径），为空时只发 HEAD /
+    std::vector<std::string> http_requests;
+    // 同一 IP:端口（明文 HTTP）上同时保持的连接数，更多的域名排队复用 keep-alive 连接；0 表示不批处理
+    size_t http_vhost_connections = 2;
+
+    // TLS 配置
+    bool starttls = false;                     // SMTP/IMAP/POP3 明文端口声明支持时尝试 STARTTLS 升级
 
     // DNS 配置
     std::string dns_resolver_type = "cares";  // cares 或 dig
     int dns_max_mx_records = 16;
     std::chrono::milliseconds dns_config_timeout = std::chrono::milliseconds(5000);
+    int dns_prefetch_workers = 8;        // DNS 预取工作线程数（每线程独立 c-ares channel）
+    size_t dns_lookahead_min = 16;       // 前瞻窗口下限
+    size_t dns_lookahead_max = 4096;     // 前瞻窗口上限
 
     // Checkpoint 配置
     size_t checkpoint_interval = 10000;  // 每处理这么多条结果就保存一次进度
@@ -132,6 +173,15 @@ public:
         size_t successful_ips = 0;          // 成功探测的 IP 数
         std::unordered_map<std::string, size_t> protocol_counts; // 各协议成功数
         std::chrono::milliseconds total_time{0}; // 总耗时
+        size_t dns_prefetch_hits = 0;       // 准入时 DNS 已预取完成
+        size_t dns_prefetch_misses = 0;     // 准入时仍需等待 DNS
+        size_t dns_lookahead_window = 0;    // 最终前瞻窗口大小
+        double dns_avg_latency_ms = 0.0;    // DNS 平滑时延
+        size_t port_attempts = 0;           // 端口预扫连接尝试数
+        size_t port_open = 0;               // 端口预扫开放数
+        size_t port_refused = 0;            // 端口预扫被拒绝数
+        size_t port_filtered = 0;           // 端口预扫超时（被过滤）数
+        size_t port_syn_sent = 0;           // SYN 扫描发出的 SYN 数
     };
     ScanStatistics get_statistics() const;
 
@@ -157,14 +207,26 @@ private:
     // 主扫描循环
     void scan_loop();
 
+    // 按前瞻窗口将 targets_ 中的目标补充到 DNS 预取器
+    void refill_dns_prefetch();
+
+    // 从预取器取出一个已解析目标并创建 session；无就绪目标时返回 nullptr
+    std::unique_ptr<ScanSession> admit_session();
+
+    // 是否仍有目标停留在 DNS 预取窗口中
+    bool prefetch_pending() const;
+
     ScannerConfig config_;
     std::vector<std::unique_ptr<IProtocol>> protocols_;
     std::unique_ptr<class IDnsResolver> dns_resolver_;
+    std::unique_ptr<class DnsPrefetcher> dns_prefetcher_;
+    std::shared_ptr<class PortScanner> port_scanner_;
     std::unique_ptr<class VendorDetector> vendor_detector_;
     std::unique_ptr<class ResultHandler> result_handler_;
 
     std::shared_ptr<ThreadPool> scan_pool_;
     std::shared_ptr<IoThreadPool> io_pool_;
+    std::unique_ptr<class EnrichStage> enrich_stage_;   // 结果后处理，运行在 scan_pool_ 上
 
     BlockingQueue<ScanReport> result_queue_;
     std::vector<ScanTarget> targets_;
@@ -189,6 +251,9 @@ private:
     std::atomic<size_t> total_targets_{0};
     std::atomic<size_t> successful_ips_{0};
     std::unordered_map<std::string, size_t> protocol_success_counts_;
+    size_t budget_bytes_count_ = 0;   // 超出字节预算的探测数（BudgetTrip::Bytes）
+    size_t budget_rate_count_ = 0;    // 接收速率过低的探测数（BudgetTrip::Rate）
+    size_t tarpit_hosts_count_ = 0;   // 判定为 tarpit 的主机数
     mutable std::mutex stats_mutex_;
 
     // 计时器
@@ -12,12 +12,17 @@
 #include <unordered_map>
 #include <queue>
 #include <functional>
+#include <mutex>
 #include <string>
+#include <utility>
 
 namespace scanner {
 
 namespace asio = boost::asio;
 
+class PortScanner;
+class EnrichStage;
+
 // =====================
 // 扫描会话（Session）
 // =====================
@@ -53,6 +58,15 @@ public:
         const std::vector<std::unique_ptr<IProtocol>>& protocols
     );
 
+    // 构造：使用 DnsPrefetcher 预先解析好的结果，构造期间不再做同步 DNS
+    ScanSession(
+        const ScanTarget& target,
+        DnsResult prefetched_dns,
+        Timeout probe_timeout,
+        ProbeMode mode,
+        const std::vector<std::unique_ptr<IProtocol>>& protocols
+    );
+
     ~ScanSession() = default;
     // ====== 端口管理 ======
     const std::vector<Port>& available_ports() const { return available_ports_; }
@@ -73,9 +87,9 @@ public:
 
     // ====== 任务计数 ======
     void set_expected_tasks(std::size_t n) { tasks_total_.store(n, std::memory_order_relaxed); }
-    void mark_task_completed() { tasks_completed_.fetch_add(1, std::memory_order_relaxed); }
+    void mark_task_completed(std::size_t n = 1) { tasks_completed_.fetch_add(n, std::memory_order_release); }
     std::size_t tasks_total() const { return tasks_total_.load(std::memory_order_relaxed); }
-    std::size_t tasks_completed() const { return tasks_completed_.load(std::memory_order_relaxed); }
+    std::size_t tasks_completed() const { return tasks_completed_.load(std::memory_order_acquire); }
     bool ready_to_release() const { 
         // 如果没有 IP 且域名非空，说明域名解析失败，应该允许释放
         if (target_.ip.empty() && !target_.domain.empty()) return true;
@@ -96,6 +110,11 @@ public:
     std::string error_msg() const { return error_msg_; }
     void set_error(const std::string& msg) { error_msg_ = msg; }
 
+    // ====== 端口预扫 ======
+    // 对 available_ports 做连接存活预扫；完成前不启动协议探测，
+    // 完成后由扫描线程在 start_one_probe 中只按开放端口重建探测计划
+    void begin_port_sweep(PortScanner& scanner);
+
     // 启动一次探测任务；返回是否成功启动
     bool start_one_probe(
         const std::vector<std::unique_ptr<IProtocol>>& protocols,
@@ -119,15 +138,61 @@ public:
 
     // 每协议的结果队列（线程安全），用于异步回传结果与后续统一处理
     std::shared_ptr<TaskQueue<ProtocolResult>> result_queue(const std::string& protocol_name);
+    // 只入队结果，不计数；调用方在最后一次访问 Session 时调用 mark_task_completed
     void push_result(ProtocolResult&& r);
 
+    // 结果后处理：证书解析、协议的 enrich（消费 ProtocolResult::raw）、入队并计数一次。
+    // 由 EnrichStage 在 CPU 线程池上调用；计数后 Session 随时可能被释放
+    void finish_result(const IProtocol* proto, ProtocolResult&& r);
+
+    // 结果交给 stage 在 CPU 线程池上后处理；未设置时在 IO 线程上就地完成
+    void set_enrich_stage(EnrichStage* stage) { enrich_stage_ = stage; }
+
     // 获取所有协议结果
     std::vector<ProtocolResult> protocol_results();
 
     // 设置是否仅收集成功结果
     void set_only_success(bool only_success) { only_success_ = only_success; }
 
+    // ====== tarpit 判定 ======
+    // 开启后端口预扫附带探测按 IP 散列选出的高位端口（金丝雀），连同全部端口一起开放即判定为全端口接受；
+    // 探测过程中同一应答指纹出现在 kTarpitFamilies 个不同协议族的默认端口上也判定为 tarpit。
+    // 判定后扫描线程取消该主机排队中的 TCP 探测，原因随报告输出
+    static constexpr std::size_t kTarpitCanaries = 2;
+    static constexpr int kTarpitFamilies = 3;
+    void set_tarpit_detection(bool enabled) { tarpit_detection_ = enabled; }
+    std::string tarpit_reason() const;
+
 private:
+    // 单连接 Banner 复用任务：同一端口上的多个服务端先发言协议共用一次连接（仅 AllAvailable 模式）
+    struct BannerTask {
+        Port port;
+        std::vector<IProtocol*> protocols;
+    };
+
+    enum class SweepState { None, Running, Done };
+
+    // 构建 available_ports、端口队列并预估任务数
+    void init_probe_plan(const std::vector<std::unique_ptr<IProtocol>>& protocols);
+
+    // 按当前 available_ports 重建端口队列并重新预估任务数
+    void rebuild_probe_plan(const std::vector<std::unique_ptr<IProtocol>>& protocols);
+
+    // 启动一个 Banner 复用任务，完成时按候选协议数计数
+    void start_banner_probe(ThreadPool& scan_pool, const boost::asio::any_io_executor& exec, Timeout timeout);
+
+    // IO 线程上的探测回调：把结果交给后处理阶段
+    void complete_result(const IProtocol* proto, ProtocolResult&& r);
+
+    // 记录一条结果的应答指纹，同一指纹覆盖的协议族达到阈值时判定为 tarpit（IO / CPU 线程调用）
+    void note_reply(const ProtocolResult& r);
+    void flag_tarpit(std::string reason);
+    // 丢弃排队中的 TCP 探测并按任务数计数（扫描线程调用）
+    void cancel_pending_probes(const std::vector<std::unique_ptr<IProtocol>>& protocols);
+
+    // 有效超时 = max(协议默认超时, 全局/动态超时)
+    Timeout effective_timeout(const IProtocol& proto, Timeout timeout) const;
+
     ScanTarget target_;
     std::shared_ptr<class IDnsResolver> dns_resolver_;
     Timeout dns_timeout_;
@@ -144,6 +209,11 @@ private:
 
     // 每协议待扫描端口队列（顺序扫描，不并行同协议多端口）
     std::unordered_map<std::string, std::queue<Port>> protocol_port_queues_;
+    std::queue<BannerTask> banner_queue_;
+
+    // 端口预扫：IO 线程写入 open_ports_ 后以 sweep_state_ = Done 发布
+    std::atomic<SweepState> sweep_state_{SweepState::None};
+    std::vector<Port> open_ports_;
     // 每协议探测结果队列（线程安全，用于避免 if-else 分发）
     std::unordered_map<std::string, std::shared_ptr<TaskQueue<ProtocolResult>>> protocol_result_queues_;
 
@@ -153,6 +223,25 @@ private:
 
     // 过滤策略
     bool only_success_{false};
+
+    // tarpit 判定：每个（协议, 默认端口）及端口族——首个以该端口为默认端口的协议下标（构建计划时记录）
+    struct PortOwner {
+        Port port;
+        uint8_t family;
+        std::string protocol;
+    };
+    bool tarpit_detection_{false};
+    std::vector<PortOwner> port_owners_;
+    std::vector<Port> canary_ports_;
+    mutable std::mutex tarpit_mutex_;
+    std::unordered_map<std::string, uint32_t> reply_families_;   // 应答指纹 -> 端口族位图
+    bool answered_{false};                                        // 已有成功结果
+    std::string tarpit_reason_;
+    std::atomic<bool> tarpit_{false};
+    bool tarpit_cancelled_{false};   // 仅扫描线程访问
+
+    // 结果后处理阶段（CPU 线程池）
+    EnrichStage* enrich_stage_{nullptr};
 };
 
 } // namespace scanner
@@ -2,6 +2,15 @@
 
 #include "../protocols/protocol_base.h"
 #include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace scanner {
@@ -10,6 +19,9 @@ using boost::asio::ip::tcp;
 using boost::asio::steady_timer;
 namespace asio = boost::asio;
 
+class IoThreadPool;
+class SynScanner;
+
 // =====================
 // 端口扫描结果
 // =====================
@@ -21,23 +33,59 @@ struct PortScanResult {
     double response_time_ms;
 };
 
+// =====================
+// 端口扫描配置与统计
+// =====================
+
+struct PortScannerConfig {
+    std::chrono::milliseconds connect_timeout{1000};  // 单主机全部端口共用的连接期限
+    std::size_t max_inflight = 4096;                   // 同时进行的连接尝试上限
+    std::size_t rate_per_sec = 0;                      // 每秒发起的连接尝试上限，0 表示不限
+    bool syn_scan = false;                             // 使用原始套接字 SYN 扫描（需要 CAP_NET_RAW）
+    std::size_t syn_retries = 1;                       // SYN 无应答时在期限内的重发次数
+};
+
+struct PortScannerStats {
+    std::size_t attempts = 0;   // 已完成的连接尝试
+    std::size_t open = 0;       // 连接成功
+    std::size_t refused = 0;    // 对端拒绝（RST）
+    std::size_t filtered = 0;   // 期限内无响应
+    std::size_t errors = 0;     // 其他错误（不可达等）
+    std::size_t syn_sent = 0;   // SYN 扫描发出的 SYN 数（含重发）
+};
+
 // =====================
 // 端口扫描器
 // =====================
+// 只做连接、不交换数据的存活预扫：对一台主机的全部端口同时发起非阻塞连接，
+// 连接成功或失败即关闭，期限到达时一并取消未完成的尝试。
+// 每次尝试只占一个 socket 与一个开放标记，同一主机共用一个期限定时器。
+// 主机按提交顺序排队，在并发上限与速率上限内放行；各主机轮流分配到 IO 池的不同线程。
+// 大多数端口关闭或被过滤时，只把开放端口交给协议探测可省掉整套探测上下文的建立。
+// 启用 syn_scan 且有原始套接字权限时，IPv4 主机改由 SynScanner 发送无状态 SYN，
+// 不占用 socket 与 FD；所有 SYN 扫描上下文与应答接收都在同一 IO 线程上，按目标地址分发应答。
 
-class PortScanner {
+class PortScanner : public std::enable_shared_from_this<PortScanner> {
 public:
-    explicit PortScanner(asio::io_context& io);
-    ~PortScanner() = default;
+    using SweepCallback = std::function<void(std::vector<PortScanResult>&&)>;
+
+    PortScanner(IoThreadPool& io, PortScannerConfig config);
+    ~PortScanner();
+
+    // SYN 扫描后端是否可用
+    bool syn_enabled() const { return syn_ != nullptr; }
 
-    // 扫描单个端口
+    // 异步扫描一台主机的多个端口；on_done 在某个 IO 线程上以与 ports 相同的顺序回调结果
+    void async_sweep(const std::string& host, std::vector<Port> ports, SweepCallback on_done);
+
+    // 扫描单个端口（阻塞等待，不可在 IO 线程上调用）
     PortScanResult scan(
         const std::string& host,
         Port port,
         std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)
     );
 
-    // 扫描多个端口
+    // 扫描多个端口（阻塞等待，不可在 IO 线程上调用）
     std::vector<PortScanResult> scan(
         const std::string& host,
         const std::vector<Port>& ports,
@@ -51,31 +99,55 @@ public:
         std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)
     );
 
+    // 停止放行：排队中与此后提交的主机直接按全部关闭回调；已发起的尝试照常结束
+    void shutdown();
+
+    PortScannerStats stats() const;
+
 private:
-    // 同步连接检查
-    bool connect_sync(
-        const std::string& host,
-        Port port,
-        std::chrono::milliseconds timeout
-    );
+    struct Sweep;
 
-    // 异步连接检查
-    struct AsyncScanContext {
-        bool success = false;
-        bool timeout = false;
-        steady_timer timer;
-        tcp::socket socket;
-        asio::io_context& io;
+    struct PendingSweep {
+        std::string host;
+        std::vector<Port> ports;
+        std::chrono::milliseconds timeout;
+        SweepCallback on_done;
     };
 
-    void async_connect(
-        const std::string& host,
-        Port port,
-        std::chrono::milliseconds timeout,
-        std::function<void(bool)> callback
-    );
+    void submit(PendingSweep&& pending);
+
+    // 在并发与速率上限内放行排队的主机
+    void pump();
+    void launch(PendingSweep&& pending);
+    void on_sweep_done(std::size_t attempts);
+
+    // 速率受限时安排一次延迟放行（调用方持有 mutex_）
+    void arm_pacer(std::chrono::steady_clock::duration delay);
+
+    // SYN 应答分发（在 syn_ctx_ 线程上调用）
+    void on_syn_reply(std::uint32_t dst, Port port, bool open);
+
+    IoThreadPool& io_;
+    PortScannerConfig config_;
+
+    std::mutex mutex_;
+    std::deque<PendingSweep> queue_;
+    std::size_t inflight_ = 0;
+    double tokens_ = 0.0;
+    std::chrono::steady_clock::time_point last_refill_;
+    bool pacer_armed_ = false;
+    bool stopped_ = false;
+
+    std::atomic<std::size_t> attempts_{0};
+    std::atomic<std::size_t> open_{0};
+    std::atomic<std::size_t> refused_{0};
+    std::atomic<std::size_t> filtered_{0};
+    std::atomic<std::size_t> errors_{0};
 
-    asio::io_context& io_;
+    // SYN 扫描：后端、其所在的 io_context 与进行中的扫描（按目标地址索引，只在该线程上访问）
+    asio::io_context* syn_ctx_ = nullptr;
+    std::unique_ptr<SynScanner> syn_;
+    std::unordered_multimap<std::uint32_t, Sweep*> syn_sweeps_;
 };
 
 } // namespace scanner
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../protocols/protocol_base.h"
+#include "scanner/common/siphash.h"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace scanner {
+
+namespace asio = boost::asio;
+
+// =====================
+// 无状态 SYN 扫描后端
+// =====================
+// 通过原始套接字（需要 CAP_NET_RAW）自行构造 SYN 发出，不经过内核的连接状态：
+// 不占用 socket/FD、本地临时端口与 conntrack 表项。
+// 序列号与源端口由 SipHash(密钥, 源地址, 目标地址, 目标端口) 导出，
+// 回包只需校验 ack == cookie + 1 与目的端口即可确认是本机探测的应答，无需记录每次尝试。
+// 收到 SYN-ACK 即回送 RST 拆除对端半连接；收到 RST 视为端口关闭。
+// 仅支持 IPv4；发送可在任意线程调用，接收在构造时指定的 io_context 线程上回调。
+
+class SynScanner {
+public:
+    // 应答回调：dst 为目标地址（主机序），open 为 true 表示 SYN-ACK，false 表示 RST
+    using ReplyHandler = std::function<void(std::uint32_t dst, Port port, bool open)>;
+
+    // 无法创建原始套接字（缺少权限等）时返回空指针，由调用方回退到普通连接扫描
+    static std::unique_ptr<SynScanner> create(asio::io_context& ctx, ReplyHandler on_reply);
+
+    ~SynScanner();
+
+    SynScanner(const SynScanner&) = delete;
+    SynScanner& operator=(const SynScanner&) = delete;
+
+    // 开始异步接收应答
+    void start();
+
+    // 关闭原始套接字，之后不再回调
+    void stop();
+
+    // 选出发往 dst 时使用的本机源地址（不发送数据），失败返回 false
+    static bool source_for(const asio::ip::address_v4& dst, asio::ip::address_v4& src);
+
+    // 发送一个 SYN，src 为 source_for 得到的源地址；发送失败（如缓冲区满）返回 false
+    bool send_syn(const asio::ip::address_v4& src, const asio::ip::address_v4& dst, Port port);
+
+    std::size_t sent() const { return sent_.load(std::memory_order_relaxed); }
+
+private:
+    SynScanner(asio::io_context& ctx, int fd, ReplyHandler on_reply);
+
+    // 由 (src, dst, port) 导出的序列号 Cookie 与源端口
+    struct Cookie {
+        std::uint32_t seq;
+        std::uint16_t sport;
+    };
+    Cookie cookie(std::uint32_t src, std::uint32_t dst, Port port) const;
+
+    void wait_readable();
+    void drain();
+    void handle_packet(const unsigned char* pkt, std::size_t len);
+    bool send_segment(std::uint32_t src, std::uint32_t dst, std::uint16_t sport, Port dport,
+                      std::uint32_t seq, std::uint32_t ack, std::uint8_t flags);
+
+    asio::posix::stream_descriptor socket_;
+    ReplyHandler on_reply_;
+    SipKey key_;
+    std::atomic<std::size_t> sent_{0};
+};
+
+} // namespace scanner
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "protocol_base.h"
+#include <boost/asio/any_io_executor.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace scanner {
+
+// =====================
+// 单连接 Banner 复用
+// =====================
+// 服务端先发言的协议（SSH/FTP/SMTP/POP3/IMAP/Telnet）不必在同一 (ip, port) 上各连一次：
+// 建立一次连接、读取欢迎消息，按各候选协议 match_greeting 的打分选出匹配协议
+// （同分时优先以该端口为默认端口的协议），在同一连接上只运行该协议的后续对话。
+// on_complete 为每个候选协议各给出一条结果：匹配协议得到其探测结果，
+// 其余候选得到未匹配的失败结果；连接失败、超时或无法识别时所有候选共享同一错误。
+// 端口不是任何候选的默认端口时按候选的空闲催促阈值提前结束静默连接（见 IProtocol::idle_nudge）。
+
+void async_banner_probe(
+    const std::vector<IProtocol*>& candidates,
+    const std::string& target,
+    const std::string& ip,
+    Port port,
+    Timeout timeout,
+    boost::asio::any_io_executor exec,
+    std::function<void(std::vector<ProtocolResult>&&)> on_complete
+);
+
+} // namespace scanner
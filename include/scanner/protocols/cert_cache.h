@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace scanner {
+
+// =====================
+// 证书信息
+// =====================
+
+struct CertificateInfo {
+    uint32_t id = 0;
+    std::string sha256;          // DER 的 SHA-256（十六进制）
+    std::string subject;
+    std::string issuer;
+    std::string not_after;
+    std::atomic<uint64_t> seen{0};  // 被多少条结果引用
+};
+
+// =====================
+// 全局证书去重缓存
+// =====================
+// 以 DER 的 SHA-256 为键：同一证书（虚拟主机、CDN、共享托管）只解析、只存储一次，
+// 结果中只记录证书 ID（attrs.tls.cert_id），详细字段在扫描结束时按 ID 输出一张证书表。
+// 命中只需共享锁；未命中时在锁外解析，再以独占锁登记（并发登记同一证书时以先到者为准）。
+// 条目从不删除，find 返回的指针在进程内一直有效。
+
+class CertificateCache {
+public:
+    static CertificateCache& instance() {
+        static CertificateCache instance;
+        return instance;
+    }
+
+    // 登记一份 DER 证书并返回其 ID（从 1 开始）；DER 为空或无法解析时返回 0
+    uint32_t intern(std::string_view der);
+
+    // 按 ID 查询，未知 ID 返回 nullptr
+    const CertificateInfo* find(uint32_t id) const;
+
+    // 唯一证书数 / 总引用数
+    std::size_t size() const;
+    std::size_t references() const { return references_.load(std::memory_order_relaxed); }
+
+    // 按 ID 顺序输出证书表（制表符分隔）
+    void write_table(std::ostream& os) const;
+
+private:
+    CertificateCache() = default;
+
+    using Digest = std::array<unsigned char, 32>;
+
+    struct DigestHash {
+        std::size_t operator()(const Digest& d) const noexcept {
+            // 摘要本身已均匀分布，直接取前 8 字节
+            std::size_t h;
+            std::memcpy(&h, d.data(), sizeof(h));
+            return h;
+        }
+    };
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<Digest, uint32_t, DigestHash> by_digest_;
+    std::vector<std::unique_ptr<CertificateInfo>> entries_;  // 下标 = ID - 1
+    std::atomic<std::size_t> references_{0};
+};
+
+} // namespace scanner
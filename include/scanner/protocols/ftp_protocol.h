@@ -2,6 +2,7 @@
 
 #include "protocol_base.h"
 #include <boost/asio.hpp>
+#include <string_view>
 
 namespace scanner {
 
@@ -40,6 +41,27 @@ public:
         const std::string& response,
         ProtocolAttributes& attrs
     ) override;
+
+    bool server_speaks_first() const override { return true; }
+
+    int match_greeting(std::string_view greeting) const override;
+
+    void async_probe_connected(
+        ProbeConnection&& conn,
+        const std::string& target,
+        Port port,
+        Timeout timeout,
+        std::function<void(ProtocolResult&&)> on_complete
+    ) override;
+
+    // 连接后不等欢迎消息就写出后续命令（FEAT、SYST），欢迎消息与应答一次往返取回（默认关闭）
+    void set_optimistic(bool enabled) { optimistic_ = enabled; }
+    bool optimistic_enabled() const { return optimistic_; }
+
+private:
+    class Probe;
+
+    bool optimistic_ = false;
 };
 
 } // namespace scanner
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace scanner {
+
+// =====================
+// HTTP 响应头解析
+// =====================
+// 仿 picohttpparser：一次扫描切出状态行与各头部，结果都是指向接收缓冲区的 string_view，不拷贝。
+// 行尾与头部名的边界用 SSE2 每次比较 16 字节（无 SSE2 时逐字节），值中的控制字符视为格式错误。
+// 视图的有效期与传入的缓冲区相同。
+
+struct HttpHeaderField {
+    std::string_view name;    // 续行（obs-fold）的 name 为空
+    std::string_view value;   // 已去掉两端空白
+};
+
+struct HttpResponseHead {
+    static constexpr std::size_t kMaxHeaders = 64;   // 多出的头部不记录，但仍会越过
+
+    std::string_view status_line;
+    int minor_version = -1;
+    int status = 0;
+    std::string_view reason;
+
+    std::array<HttpHeaderField, kMaxHeaders> headers;
+    std::size_t num_headers = 0;
+    std::size_t header_length = 0;   // 含结尾空行的字节数，仅 Complete 时有效
+
+    // 按名查找第一个头部（不区分大小写，name 须为小写），没有时返回空
+    std::string_view find(std::string_view name) const;
+};
+
+enum class HttpParseStatus {
+    Complete,   // 读到了结尾空行
+    Partial,    // 数据不完整，已解析的完整行仍然有效
+    Invalid,    // 格式错误，之前解析的部分仍然有效
+};
+
+HttpParseStatus parse_http_response(std::string_view buf, HttpResponseHead& out);
+
+} // namespace scanner
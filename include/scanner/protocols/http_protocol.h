@@ -2,9 +2,20 @@
 
 #include "protocol_base.h"
 #include <boost/asio.hpp>
+#include <string_view>
 
 namespace scanner {
 
+struct HttpResponseHead;
+
+// 一条请求模板："方法 路径"，只写路径时方法为 GET
+struct HttpRequestSpec {
+    std::string method;
+    std::string path;
+
+    static HttpRequestSpec parse(std::string_view spec);
+};
+
 using boost::asio::ip::tcp;
 namespace asio = boost::asio;
 
@@ -13,6 +24,16 @@ public:
     HttpProtocol() = default;
     virtual ~HttpProtocol() = default;
 
+    // 在同一 keep-alive 连接上流水线发送的请求，按顺序对应响应；
+    // 第一条的响应决定状态码 / Server / Banner，其余各记一条 fields（路径 -> "状态码 原因"）
+    void set_requests(std::vector<HttpRequestSpec> requests) {
+        if (!requests.empty()) requests_ = std::move(requests);
+    }
+
+    // 虚拟主机批处理：同一 IP:端口（明文）上同时进行的连接数上限，超出的探测排队，
+    // 在前一个探测结束后复用其 keep-alive 连接发送自己的 Host 请求，省去一次 TCP 握手。0 表示不批处理
+    void set_vhost_connections(std::size_t n) { vhost_connections_ = n; }
+
     std::string name() const override { return "HTTP"; }
 
     std::vector<Port> default_ports() const override {
@@ -23,6 +44,10 @@ public:
         return Timeout(3000);
     }
 
+    bool requires_tls(Port port) const override {
+        return port == 443 || port == 8443;
+    }
+
     void async_probe(
         const std::string& target,
         const std::string& ip,
@@ -37,6 +62,18 @@ public:
         ProtocolAttributes& attrs
     ) override;
 
+    // 在留存的首个响应中查找服务端特征，追加到 Banner
+    void enrich(ProtocolResult& r) const override;
+
+private:
+    class Probe;
+    class Lanes;
+
+    // 从解析好的响应头中取状态码、Server、Content-Type
+    static void apply_head(const HttpResponseHead& head, ProtocolAttributes& attrs);
+
+    std::vector<HttpRequestSpec> requests_{{"HEAD", "/"}};
+    std::size_t vhost_connections_ = 2;
 };
 
 } // namespace scanner
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace scanner {
+
+// =====================
+// 能力关键字表
+// =====================
+// EHLO / CAPA / CAPABILITY 的关键字集合在编译期已知，用完美哈希代替逐个比较：
+// 构造时（须在常量求值中，即声明为 constexpr）搜索一个种子，使所有关键字落在互不相同的槽位，
+// 查找只需对 token 算一次哈希、再与该槽位唯一的候选比较一次。找不到种子时常量求值失败，编译报错。
+// 关键字须为小写且互不相同，token 比较不区分大小写（RFC 5321 / 2449 / 3501 均规定大小写无关）。
+// 下标即能力位，多个 token 的命中可以合成一个 uint32_t 位集。
+
+// 以空格切分 token，连续空格视作一个分隔，只扫一遍
+template <typename F>
+inline void for_each_token(std::string_view line, F&& f) {
+    std::size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && line[i] == ' ') ++i;
+        std::size_t start = i;
+        while (i < line.size() && line[i] != ' ') ++i;
+        if (i > start) f(line.substr(start, i - start));
+    }
+}
+
+// 拆出行首关键字与其后的参数；关键字止于空格或 '='（兼容旧式 "AUTH=LOGIN PLAIN"）
+inline std::pair<std::string_view, std::string_view> split_keyword(std::string_view line) {
+    std::size_t end = line.find_first_of(" =");
+    if (end == std::string_view::npos) return {line, {}};
+    std::string_view params = line.substr(end + 1);
+    while (!params.empty() && params.front() == ' ') params.remove_prefix(1);
+    return {line.substr(0, end), params};
+}
+
+template <std::size_t N>
+class KeywordTable {
+    static_assert(N > 0 && N <= 32);
+
+public:
+    static constexpr std::size_t npos = N;
+
+    constexpr explicit KeywordTable(const std::array<std::string_view, N>& words) : words_(words) {
+        for (uint32_t seed = 1; seed <= kMaxSeed; ++seed) {
+            if (place(seed)) return;
+        }
+        throw std::logic_error("KeywordTable: no perfect hash seed");
+    }
+
+    // 命中时返回关键字下标，否则返回 npos
+    constexpr std::size_t find(std::string_view token) const {
+        uint8_t slot = slots_[hash(token, seed_) & (kSlots - 1)];
+        if (slot == 0) return npos;
+        std::size_t k = slot - 1;
+        return equals(token, words_[k]) ? k : npos;
+    }
+
+    // 一行中所有命中关键字的位集
+    constexpr uint32_t match_all(std::string_view line) const {
+        uint32_t bits = 0;
+        for_each_token(line, [&](std::string_view token) {
+            std::size_t k = find(token);
+            if (k != npos) bits |= 1u << k;
+        });
+        return bits;
+    }
+
+private:
+    static constexpr std::size_t kSlots = std::bit_ceil(2 * N);
+    static constexpr uint32_t kMaxSeed = 1u << 16;
+
+    static constexpr char lower(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    static constexpr uint32_t hash(std::string_view s, uint32_t seed) {
+        uint32_t h = 2166136261u ^ seed;
+        for (char c : s) h = (h ^ static_cast<unsigned char>(lower(c))) * 16777619u;
+        return h ^ (h >> 16);
+    }
+
+    static constexpr bool equals(std::string_view token, std::string_view word) {
+        if (token.size() != word.size()) return false;
+        for (std::size_t i = 0; i < token.size(); ++i) {
+            if (lower(token[i]) != word[i]) return false;
+        }
+        return true;
+    }
+
+    constexpr bool place(uint32_t seed) {
+        slots_ = {};
+        for (std::size_t i = 0; i < N; ++i) {
+            auto& slot = slots_[hash(words_[i], seed) & (kSlots - 1)];
+            if (slot != 0) return false;
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        seed_ = seed;
+        return true;
+    }
+
+    std::array<std::string_view, N> words_;
+    std::array<uint8_t, kSlots> slots_{};   // 槽位 -> 关键字下标 + 1，0 为空
+    uint32_t seed_ = 0;
+};
+
+} // namespace scanner
@@ -0,0 +1,719 @@
+#pragma once
+
+#include "protocol_base.h"
+#include "scanner/common/logger.h"
+#include "scanner/common/probe_pool.h"
+#include "probe_task.h"
+#include "recv_buffer.h"
+#include "tls_context.h"
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace scanner {
+
+namespace asio = boost::asio;
+
+// =====================
+// 探测参数
+// =====================
+
+struct ProbeParams {
+    std::string protocol;       // 协议名称（写入结果与错误信息）
+    std::string target;         // 目标域名或 IP（逻辑标识 / Host 头）
+    std::string ip;             // 实际连接的 IP 地址
+    Port port = 0;
+    Timeout timeout{0};
+    asio::any_io_executor exec;
+    std::function<void(ProtocolResult&&)> on_complete;
+    bool tls = false;           // 连接后先完成 TLS 握手（隐式 TLS 端口）
+    Timeout idle{0};            // 空闲催促阈值（见 IProtocol::idle_nudge），0 表示不催促
+    std::string_view nudge{};   // 催促时写出的数据（静态存储）
+};
+
+// =====================
+// 接收速率下限
+// =====================
+// 所有探测共用，扫描开始前设置一次（Scanner::init_protocols），之后只读。
+
+struct RecvRateLimit {
+    std::size_t min_bytes_per_sec = 0;   // 0 表示不检查
+    Timeout window{2000};                // 统计窗口
+};
+
+inline RecvRateLimit& recv_rate_limit() {
+    static RecvRateLimit limit;
+    return limit;
+}
+
+// =====================
+// 已建立的连接
+// =====================
+// 一次探测可把连接连同未消费的接收数据交给另一协议继续对话（见 ProbeEngine::adopt）。
+
+struct ProbeConnection {
+    asio::ip::tcp::socket socket;
+    RecvBuffer buffer;
+    std::chrono::steady_clock::time_point connected_at;  // 连接建立时刻（响应时间的起点）
+    std::size_t uses = 0;                                 // 此前已在该连接上完成的探测数（连接复用时累计）
+};
+
+// =====================
+// 统一探测引擎（CRTP + 协程）
+// =====================
+// 引擎负责连接、超时、接收缓冲与完成回调，各协议只以协程描述对话流程。
+// Dialect 需要实现：
+//   ProbeTask run();                                        连接成功后的对话（协程）
+// 可选覆盖：
+//   bool on_read_error(const error_code& ec, const char* what);
+//       读失败策略。返回 true 时以当前缓冲内容（可能为空）继续对话；
+//       返回 false 时对话终止（默认：判定失败）。
+//   void on_finished();
+//       结果回调之后的收尾（默认什么也不做）。
+// 步骤以 co_await 串联：
+//   auto line = co_await read_line("banner");
+//   co_await write(cmd, "EHLO");
+// 步骤失败时引擎直接结束探测，协程不再恢复，随上下文一起销毁。
+// 缓冲中已有完整数据的读步骤不挂起，直接返回（例如一次到达的多行 EHLO 响应）。
+// 接收缓冲定长（RecvBuffer::kCapacity），单行或响应头超过容量、累计接收超过
+// RecvBuffer::kMaxTotalBytes 时判定失败；Banner 写入定长的 banner()，结束时一次写入结果。
+// 接收速率另有下限（recv_rate_limit()）：一个统计窗口内数据分成至少 kDripReads 段到达、
+// 平均速率却低于下限时视为滴灌，不等总超时即结束。两种预算触发时结果记 BudgetTrip，
+// settle() 之后照常判定成功。
+// 连接可经 release_connection() 交给另一协议的 adopt()，后者跳过连接步骤直接从缓冲继续读。
+// 对端提前关闭时 Dialect 可 co_await reconnect() 在新连接上继续（如 HTTP 流水线的剩余请求）。
+// ProbeParams::tls 为 true 时连接后先在线程内共享的 SSL_CTX 上握手（见 tls_context.h），
+// 此后读写步骤透明地走 TLS 流；握手信息与证书 DER 写入 attrs.tls，证书解析留给 CPU 线程池。
+// 明文协议在对端同意 STARTTLS/STLS 后 co_await start_tls() 在同一连接上升级；
+// 升级失败或超时不影响明文阶段已得到的结果，探测照常判定成功。
+// 同理，Dialect 在拿到足够结果后可调用 settle()，此后的附加步骤（如 SSH KEXINIT）读失败或超时按成功收尾。
+// ProbeParams::idle 非 0 时（明文、新建连接），run() 之前先等对端发言：空闲 idle 仍无数据就写出 nudge，
+// 再空闲 idle 仍无数据即结束探测，不等满整个超时；对 nudge 有应答说明对端等客户端先发言，
+// 按应答归类写入错误信息后结束。首段数据只窥视不消费，run() 照常从头读取。
+// 上下文连同控制块由 allocate_shared 从 ProbePool 分配，协程帧、Asio 操作对象与接收缓冲
+// 同样来自 ProbePool，稳态下单次探测不触发 operator new（结果中的字符串除外）。
+
+template <typename Dialect>
+class ProbeEngine : public std::enable_shared_from_this<Dialect> {
+public:
+    // 创建并启动一次探测；额外参数转发给 Dialect 构造函数
+    template <typename... Args>
+    static void launch(ProbeParams params, Args&&... args) {
+        auto self = std::allocate_shared<Dialect>(ProbeAllocator<Dialect>(),
+                                                  std::move(params), std::forward<Args>(args)...);
+        static_cast<ProbeEngine&>(*self).start();
+    }
+
+    // 在已建立的连接上创建并启动一次探测；conn 中已收到的数据对首个读步骤可见
+    template <typename... Args>
+    static void adopt(ProbeParams params, ProbeConnection&& conn, Args&&... args) {
+        auto self = std::allocate_shared<Dialect>(ProbeAllocator<Dialect>(),
+                                                  std::move(params), std::forward<Args>(args)...);
+        auto& engine = static_cast<ProbeEngine&>(*self);
+        engine.socket_ = std::move(conn.socket);
+        engine.buffer_ = std::move(conn.buffer);
+        engine.start_time_ = conn.connected_at;
+        engine.connected_ = true;
+        engine.start();
+    }
+
+    ProbeEngine(const ProbeEngine&) = delete;
+    ProbeEngine& operator=(const ProbeEngine&) = delete;
+
+protected:
+    explicit ProbeEngine(ProbeParams&& params)
+        : socket_(params.exec),
+          timer_(params.exec),
+          idle_timer_(params.exec),
+          params_(std::move(params)) {
+        result_.protocol = std::move(params_.protocol);
+        result_.host = std::move(params_.target);
+        result_.port = params_.port;
+    }
+
+    ~ProbeEngine() = default;
+
+    // ====== 可等待的步骤 ======
+
+    enum class ReadMode { Line, Reply, Until, Some, Exact, Peek };
+
+    class HandshakeStep {
+    public:
+        HandshakeStep(ProbeEngine& engine, bool upgrade) : engine_(engine), upgrade_(upgrade) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { engine_.initiate_handshake(upgrade_, h); }
+        void await_resume() const noexcept {}
+
+    private:
+        ProbeEngine& engine_;
+        bool upgrade_;
+    };
+
+    class ReadStep {
+    public:
+        ReadStep(ProbeEngine& engine, ReadMode mode, const char* what,
+                 std::string_view delim = {}, std::size_t max_bytes = 0, Timeout idle = Timeout(0))
+            : engine_(engine), mode_(mode), what_(what), delim_(delim), max_bytes_(max_bytes), idle_(idle) {}
+
+        bool await_ready() { return engine_.take_buffered(*this); }
+        void await_suspend(std::coroutine_handle<> h) { engine_.initiate_read(*this, h); }
+        std::string_view await_resume() const noexcept { return data_; }
+
+    private:
+        friend class ProbeEngine;
+        ProbeEngine& engine_;
+        ReadMode mode_;
+        const char* what_;
+        std::string_view delim_;
+        std::size_t max_bytes_;
+        Timeout idle_;             // 非 0 时空闲这么久仍无数据即以空结果返回（只用于首段数据）
+        std::string_view data_;
+    };
+
+    class WriteStep {
+    public:
+        WriteStep(ProbeEngine& engine, std::string_view data, const char* what)
+            : engine_(engine), data_(data), what_(what) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { engine_.initiate_write(*this, h); }
+        void await_resume() const noexcept {}
+
+    private:
+        friend class ProbeEngine;
+        ProbeEngine& engine_;
+        std::string_view data_;
+        const char* what_;
+    };
+
+    // 读取一行（去掉行尾 "\r\n"）。返回的视图直接指向接收缓冲，
+    // 只在发起下一个读步骤之前有效，需要保留的内容应自行复制。
+    ReadStep read_line(const char* what) {
+        return ReadStep(*this, ReadMode::Line, what);
+    }
+
+    // 读取一个完整的多行应答（"ddd-" 续行直到 "ddd " 结束行），一次返回整块（含行尾），
+    // 已在缓冲中的行不再逐行往返，由 Dialect 用 next_line 一次遍历解析
+    ReadStep read_reply(const char* what) {
+        return ReadStep(*this, ReadMode::Reply, what);
+    }
+
+    // 读取直到出现分隔符，返回到分隔符为止（含分隔符）的数据；delim 须为字符串常量
+    ReadStep read_until(std::string_view delim, const char* what) {
+        return ReadStep(*this, ReadMode::Until, what, delim);
+    }
+
+    // 读取一次可用数据（最多 max_bytes），返回缓冲中的全部未消费数据
+    ReadStep read_some(std::size_t max_bytes, const char* what) {
+        return ReadStep(*this, ReadMode::Some, what, {}, max_bytes);
+    }
+
+    // 读取恰好 n 字节（二进制报文），n 不能超过 RecvBuffer::kCapacity
+    ReadStep read_exact(std::size_t n, const char* what) {
+        return ReadStep(*this, ReadMode::Exact, what, {}, n);
+    }
+
+    // 等待至少一段数据到达，返回缓冲中的全部数据但不消费（后续读步骤仍能读到）
+    ReadStep peek(const char* what) {
+        return ReadStep(*this, ReadMode::Peek, what);
+    }
+
+    // 在明文连接上升级到 TLS（对端已同意 STARTTLS/STLS 之后）。
+    // 缓冲中尚未消费的明文被丢弃，防止明文注入混入加密阶段。
+    HandshakeStep start_tls() {
+        return HandshakeStep(*this, true);
+    }
+
+    bool tls_active() const { return tls_.has_value(); }
+
+    // 写出数据；data 的存储必须在写完成前保持有效（静态常量或 Dialect 成员）
+    WriteStep write(std::string_view data, const char* what) {
+        return WriteStep(*this, data, what);
+    }
+
+    // 结果回调之后调用（每个探测恰好一次，包括超时与连接失败），Dialect 可覆盖以归还共享资源
+    void on_finished() {}
+
+    // 默认读失败策略
+    bool on_read_error(const boost::system::error_code& ec, const char* what) {
+        if (settled_) {
+            finish_success();
+            return false;
+        }
+        finish_error(std::string("Read ") + what + " failed: " + ec.message());
+        return false;
+    }
+
+    // 已有足够结果：后续步骤失败或超时都不再否定本次探测
+    void settle() { settled_ = true; }
+
+    // 把剩余期限收紧到至多 limit（只缩短，不延长）
+    void tighten_deadline(Timeout limit) {
+        if (completed_) return;
+        if (asio::steady_timer::clock_type::now() + limit < timer_.expiry()) {
+            arm_timer(limit);
+        }
+    }
+
+    void finish_success() {
+        result_.accessible = true;
+        auto end = std::chrono::steady_clock::now();
+        result_.attrs.response_time_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time_).count();
+        complete();
+    }
+
+    void finish_error(const std::string& msg) {
+        result_.error = msg;
+        complete();
+    }
+
+    bool completed() const { return completed_; }
+    ProtocolResult& result() { return result_; }
+    BannerStore& banner() { return banner_; }
+    ProtocolAttributes& attrs() { return result_.attrs; }
+    const std::string& target() const { return result_.host; }
+    Port port() const { return params_.port; }
+    Timeout timeout() const { return params_.timeout; }
+
+    // 关闭当前连接并重新连接到同一端点（隐式 TLS 端口重新握手，可复用会话），接收缓冲与累计字节清零。
+    // 用于对端提前关闭后继续对话；连接或握手失败时探测结束（settle() 之后按成功收尾）
+    ProbeTask reconnect() {
+        boost::system::error_code ec;
+        tls_.reset();
+        socket_.close(ec);
+        buffer_.reset();
+        rate_window_start_ = {};
+        rate_window_bytes_ = rate_window_reads_ = 0;
+        auto address = asio::ip::make_address(params_.ip, ec);
+        if (ec) {
+            finish_error("Invalid address: " + ec.message());
+            co_return;
+        }
+        co_await ConnectStep(*this, asio::ip::tcp::endpoint(address, params_.port));
+        if (params_.tls) {
+            co_await HandshakeStep(*this, false);
+        }
+    }
+
+    // 交出连接与未消费数据但不结束探测（仅明文连接），随后仍须 finish_success/finish_error 给出本探测结果；
+    // 用于对话正常结束后把 keep-alive 连接留给下一个探测（见 HttpProtocol 的虚拟主机批处理）
+    ProbeConnection take_connection() {
+        return ProbeConnection{std::move(socket_), std::move(buffer_), start_time_};
+    }
+
+    // 结束本探测但不回调结果，把连接与未消费数据交出，由接手的协议负责给出结果（仅明文连接）
+    ProbeConnection release_connection() {
+        completed_ = true;
+        (void)timer_.cancel();
+        return ProbeConnection{std::move(socket_), std::move(buffer_), start_time_};
+    }
+
+    // 应答归类：HTTP、TLS 记录或首行文本（用于 nudge 的应答与无法识别的欢迎消息）
+    static std::string describe_reply(std::string_view data) {
+        if (data.substr(0, 5) == "HTTP/") {
+            std::string_view line;
+            next_line(data, line);
+            return "HTTP (" + std::string(line.substr(0, 64)) + ")";
+        }
+        if (data.size() >= 2 && (data[0] == 0x15 || data[0] == 0x16) && data[1] == 0x03) {
+            return "TLS record";
+        }
+        std::string_view line;
+        next_line(data, line);
+        line = line.substr(0, 64);
+        bool text = !line.empty() && std::all_of(line.begin(), line.end(), [](char c) {
+            return static_cast<unsigned char>(c) >= 0x20 && static_cast<unsigned char>(c) < 0x7f;
+        });
+        return text ? "text (" + std::string(line) + ")" : "binary (" + std::to_string(data.size()) + " bytes)";
+    }
+
+private:
+    class ConnectStep {
+    public:
+        ConnectStep(ProbeEngine& engine, asio::ip::tcp::endpoint endpoint)
+            : engine_(engine), endpoint_(endpoint) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { engine_.initiate_connect(*this, h); }
+        void await_resume() const noexcept {}
+
+    private:
+        friend class ProbeEngine;
+        ProbeEngine& engine_;
+        asio::ip::tcp::endpoint endpoint_;
+    };
+
+    Dialect& derived() { return static_cast<Dialect&>(*this); }
+    std::shared_ptr<Dialect> self_ptr() { return this->shared_from_this(); }
+
+    // 缓冲中的数据满足读步骤时取出并返回 true
+    bool take_buffered(ReadStep& step) {
+        std::size_t len = std::string_view::npos;
+        switch (step.mode_) {
+            case ReadMode::Line:
+                len = buffer_.find_line();
+                break;
+            case ReadMode::Reply:
+                len = buffer_.find_reply();
+                break;
+            case ReadMode::Until:
+                len = buffer_.find(step.delim_);
+                break;
+            case ReadMode::Exact:
+                if (buffer_.size() >= step.max_bytes_) len = step.max_bytes_;
+                break;
+            case ReadMode::Some:
+            case ReadMode::Peek:
+                if (!buffer_.empty()) len = buffer_.size();
+                break;
+        }
+        if (len == std::string_view::npos) return false;
+        take(step, len);
+        return true;
+    }
+
+    // 取出前 len 字节作为步骤结果。consume 只移动读指针，视图在下一次读之前保持有效
+    void take(ReadStep& step, std::size_t len) {
+        std::string_view data = buffer_.data().substr(0, len);
+        if (step.mode_ == ReadMode::Peek) {
+            step.data_ = data;
+            return;
+        }
+        buffer_.consume(len);
+        if (step.mode_ == ReadMode::Line) {
+            if (!data.empty() && data.back() == '\n') data.remove_suffix(1);
+            if (!data.empty() && data.back() == '\r') data.remove_suffix(1);
+        }
+        step.data_ = data;
+    }
+
+    // 读完成：数据满足步骤时恢复协程，否则继续读；失败时按 Dialect 策略处理
+    void on_read(ReadStep& step, std::coroutine_handle<> h,
+                 const boost::system::error_code& ec, std::size_t bytes) {
+        if (completed_) return;
+        if (step.idle_.count() > 0) {
+            step.idle_ = Timeout(0);
+            ++idle_gen_;
+            (void)idle_timer_.cancel();
+            // 空闲到期取消了读：以空结果返回，连接保持
+            if (std::exchange(idle_expired_, false) && ec == asio::error::operation_aborted) {
+                step.data_ = {};
+                h.resume();
+                return;
+            }
+        }
+        if (ec) {
+            // 催促之后对端关闭或重置：对端不是先发言的服务，不交给 Dialect 的读失败策略
+            if (nudged_ && buffer_.empty()) {
+                finish_error("Closed after nudge: " + ec.message());
+                return;
+            }
+            // EOF 时缓冲中的残余数据作为最后一段交给 Dialect
+            if (ec == asio::error::eof && !buffer_.empty()) {
+                take(step, buffer_.size());
+                h.resume();
+                return;
+            }
+            if (!derived().on_read_error(ec, step.what_) || completed_) return;
+            take(step, buffer_.size());
+            h.resume();
+            return;
+        }
+        buffer_.commit(bytes);
+        if (buffer_.over_limit()) {
+            trip_budget(BudgetTrip::Bytes, std::string("Read ") + step.what_ + " failed: byte limit exceeded");
+            return;
+        }
+        if (!check_rate(bytes, step.what_)) return;
+        if (take_buffered(step)) {
+            h.resume();
+        } else {
+            initiate_read(step, h);
+        }
+    }
+
+    void initiate_read(ReadStep& step, std::coroutine_handle<> h) {
+        std::size_t room = buffer_.prepare();
+        if (room == 0) {
+            trip_budget(BudgetTrip::Bytes, std::string("Read ") + step.what_ + " failed: response exceeds buffer");
+            return;
+        }
+        if (rate_window_start_ == std::chrono::steady_clock::time_point{}) {
+            rate_window_start_ = std::chrono::steady_clock::now();
+        }
+        if (step.mode_ == ReadMode::Some) {
+            room = std::min(room, step.max_bytes_);
+        }
+        if (step.idle_.count() > 0) {
+            arm_idle(step.idle_);
+        }
+        auto handler = pooled(
+            [this, self = self_ptr(), &step, h](const boost::system::error_code& ec, std::size_t bytes) {
+                on_read(step, h, ec, bytes);
+            });
+        if (tls_) {
+            tls_->async_read_some(asio::buffer(buffer_.tail(), room), std::move(handler));
+        } else {
+            socket_.async_read_some(asio::buffer(buffer_.tail(), room), std::move(handler));
+        }
+    }
+
+    void initiate_write(WriteStep& step, std::coroutine_handle<> h) {
+        auto handler = pooled(
+            [this, self = self_ptr(), &step, h](const boost::system::error_code& ec, std::size_t) {
+                if (completed_) return;
+                if (ec) {
+                    if (settled_) {
+                        finish_success();
+                        return;
+                    }
+                    finish_error(std::string("Write ") + step.what_ + " failed: " + ec.message());
+                    return;
+                }
+                h.resume();
+            });
+        auto data = asio::buffer(step.data_.data(), step.data_.size());
+        if (tls_) {
+            asio::async_write(*tls_, data, std::move(handler));
+        } else {
+            asio::async_write(socket_, data, std::move(handler));
+        }
+    }
+
+    void initiate_handshake(bool upgrade, std::coroutine_handle<> h) {
+        if (upgrade) {
+            buffer_.consume(buffer_.size());
+            upgrading_ = true;
+            settled_ = true;
+        }
+        tls_.emplace(socket_, tls_client_context());
+        tls_peer_ = TlsPeer{params_.ip, params_.port};
+        tls_prepare_client(tls_->native_handle(), tls_peer_, result_.host);
+        tls_->async_handshake(asio::ssl::stream_base::client, pooled(
+            [this, self = self_ptr(), h](const boost::system::error_code& ec) {
+                if (completed_) return;
+                if (ec) {
+                    if (upgrading_) {
+                        LOG_NETWORK_DEBUG("STARTTLS handshake with {}:{} failed: {}",
+                                          result_.host, params_.port, ec.message());
+                    }
+                    if (upgrading_ || settled_) {
+                        finish_success();
+                        return;
+                    }
+                    finish_error("TLS handshake failed: " + ec.message());
+                    return;
+                }
+                // reconnect() 的重新握手不覆盖首次握手的记录
+                if (!result_.attrs.tls.enabled) record_tls();
+                upgrading_ = false;
+                h.resume();
+            }));
+    }
+
+    // 记录握手结果；证书只拷贝 DER，哈希与解析由 tls_inspect_certificate 在 CPU 线程池完成
+    void record_tls() {
+        SSL* ssl = tls_->native_handle();
+        auto& tls = result_.attrs.tls;
+        tls.enabled = true;
+        tls.starttls = upgrading_;
+        tls.resumed = SSL_session_reused(ssl) == 1;
+        tls.version = SSL_get_version(ssl);
+        tls.cipher = SSL_get_cipher_name(ssl);
+        if (X509* cert = SSL_get0_peer_certificate(ssl)) {
+            int len = i2d_X509(cert, nullptr);
+            if (len > 0) {
+                tls.cert_der.resize(static_cast<std::size_t>(len));
+                auto* out = reinterpret_cast<unsigned char*>(tls.cert_der.data());
+                i2d_X509(cert, &out);
+            }
+        }
+    }
+
+    void initiate_connect(ConnectStep& step, std::coroutine_handle<> h) {
+        socket_.async_connect(step.endpoint_, pooled(
+            [this, self = self_ptr(), h](const boost::system::error_code& ec) {
+                if (completed_) return;
+                if (ec) {
+                    if (settled_) {
+                        finish_success();
+                        return;
+                    }
+                    finish_error("Connect failed: " + ec.message());
+                    return;
+                }
+                h.resume();
+            }));
+    }
+
+    void start() {
+        if (!connected_) {
+            start_time_ = std::chrono::steady_clock::now();
+        }
+
+        arm_timer(params_.timeout);
+
+        // 协程在 socket 所属的 IO 线程上启动，整个对话与超时回调串行执行
+        asio::post(params_.exec, pooled([this, self = self_ptr()]() {
+            if (completed_) return;
+            task_ = drive();
+            task_.start();
+        }));
+    }
+
+    // 超时处理；重新设定到期时间时，旧的等待以 operation_aborted 返回
+    void arm_timer(Timeout after) {
+        timer_.expires_after(after);
+        timer_.async_wait(pooled([this, self = self_ptr()](const boost::system::error_code& ec) {
+            if (ec) return;
+            // STARTTLS 握手、settle() 之后的附加步骤超时不否定已得到的结果
+            if (settled_) {
+                finish_success();
+                return;
+            }
+            finish_error(result_.protocol + " probe timed out");
+        }));
+    }
+
+    // 超出接收预算：记下类别后结束，settle() 之后保留已有结果
+    void trip_budget(BudgetTrip trip, std::string msg) {
+        result_.budget = trip;
+        if (settled_) {
+            finish_success();
+            return;
+        }
+        finish_error(std::move(msg));
+    }
+
+    // 每次收到数据时累计到当前窗口；窗口满时判断是否滴灌，否则开始新窗口。
+    // 只按分段数与平均速率判断：先发一段、停顿很久再发其余部分（如 SMTP greet pause）不算滴灌
+    bool check_rate(std::size_t bytes, const char* what) {
+        const auto& limit = recv_rate_limit();
+        if (limit.min_bytes_per_sec == 0) return true;
+        ++rate_window_reads_;
+        rate_window_bytes_ += bytes;
+        auto now = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - rate_window_start_);
+        if (elapsed < limit.window) return true;
+        if (rate_window_reads_ >= kDripReads &&
+            rate_window_bytes_ * 1000 < limit.min_bytes_per_sec * static_cast<std::size_t>(elapsed.count())) {
+            trip_budget(BudgetTrip::Rate, std::string("Read ") + what + " failed: " +
+                        std::to_string(rate_window_bytes_) + " bytes in " + std::to_string(elapsed.count()) +
+                        "ms, below " + std::to_string(limit.min_bytes_per_sec) + " B/s");
+            return false;
+        }
+        rate_window_start_ = now;
+        rate_window_bytes_ = 0;
+        rate_window_reads_ = 0;
+        return true;
+    }
+
+    // 空闲计时到期时取消挂起的读；世代号使已被后续读取代的旧计时失效
+    void arm_idle(Timeout idle) {
+        idle_timer_.expires_after(idle);
+        idle_timer_.async_wait(pooled([this, self = self_ptr(), gen = ++idle_gen_](const boost::system::error_code& ec) {
+            if (ec || completed_ || gen != idle_gen_) return;
+            idle_expired_ = true;
+            boost::system::error_code ignored;
+            socket_.cancel(ignored);
+        }));
+    }
+
+    // 等待对端先发言（见类注释中的空闲催促）；探测因此结束时 completed_ 置位
+    ProbeTask await_greeting() {
+        auto data = co_await ReadStep(*this, ReadMode::Peek, "greeting", {}, 0, params_.idle);
+        if (!data.empty() || completed_) co_return;
+
+        co_await WriteStep(*this, params_.nudge, "nudge");
+        nudged_ = true;
+        data = co_await ReadStep(*this, ReadMode::Peek, "nudge reply", {}, 0, params_.idle);
+        if (completed_) co_return;
+        if (data.empty()) {
+            finish_error("No data within " + std::to_string(params_.idle.count() * 2) + "ms (idle nudge)");
+            co_return;
+        }
+        finish_error("Waits for client, nudge reply: " + describe_reply(data));
+    }
+
+    // 根协程：连接后交给 Dialect 的对话流程
+    ProbeTask drive() {
+        try {
+            if (!connected_) {
+                boost::system::error_code ec;
+                auto address = asio::ip::make_address(params_.ip, ec);
+                if (ec) {
+                    finish_error("Invalid address: " + ec.message());
+                    co_return;
+                }
+
+                co_await ConnectStep(*this, asio::ip::tcp::endpoint(address, params_.port));
+                connected_ = true;
+                start_time_ = std::chrono::steady_clock::now();
+
+                if (params_.tls) {
+                    co_await HandshakeStep(*this, false);
+                } else if (params_.idle.count() > 0) {
+                    co_await await_greeting();
+                    if (completed_) co_return;
+                }
+            }
+
+            co_await derived().run();
+            if (!completed_) {
+                finish_error(result_.protocol + " dialog ended without result");
+            }
+        } catch (const std::exception& e) {
+            finish_error(std::string("Probe error: ") + e.what());
+        }
+    }
+
+    void complete() {
+        if (completed_) return;
+        completed_ = true;
+        boost::system::error_code ec;
+        (void)timer_.cancel();
+        (void)idle_timer_.cancel();
+        socket_.close(ec);
+        if (!banner_.empty()) {
+            result_.attrs.banner.assign(banner_.view());
+        }
+        if (params_.on_complete) {
+            params_.on_complete(std::move(result_));
+        }
+        derived().on_finished();
+    }
+
+    asio::ip::tcp::socket socket_;
+    TlsPeer tls_peer_;                                                // 会话缓存键（新会话回调中读取）
+    std::optional<asio::ssl::stream<asio::ip::tcp::socket&>> tls_;  // 引用 socket_，先于其销毁
+    asio::steady_timer timer_;
+    asio::steady_timer idle_timer_;
+    RecvBuffer buffer_;
+    BannerStore banner_;
+    ProbeParams params_;
+    ProtocolResult result_;
+    std::chrono::steady_clock::time_point start_time_;
+    bool connected_{false};
+    bool completed_{false};
+    bool upgrading_{false};   // STARTTLS 握手进行中
+    bool settled_{false};     // 见 settle()
+    bool idle_expired_{false};  // 空闲计时到期、挂起的读已被取消
+    bool nudged_{false};        // 已写出催促数据（此后探测总是在 await_greeting 中结束）
+    static constexpr std::size_t kDripReads = 4;   // 窗口内至少这么多段才可能判定为滴灌
+    std::chrono::steady_clock::time_point rate_window_start_;
+    std::size_t rate_window_bytes_{0};
+    std::size_t rate_window_reads_{0};
+    unsigned idle_gen_{0};
+    ProbeTask task_;  // 最后声明、最先销毁：挂起中的协程帧先于套接字与缓冲释放
+};
+
+} // namespace scanner
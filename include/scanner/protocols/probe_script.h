@@ -0,0 +1,91 @@
+#pragma once
+
+#include "protocol_base.h"
+#include <cstdint>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace scanner {
+
+// =====================
+// 声明式探测定义
+// =====================
+// 探测以 JSON 定义（默认 config/probes.json），启动时编译为字节码，由 ScriptedProtocol
+// 的通用解释器在 ProbeEngine 上执行。新增服务无需 C++ 代码与重新编译：
+//
+//   {
+//     "name": "REDIS", "enabled": false, "ports": [6379], "timeout_ms": 3000,
+//     "steps": [
+//       {"send": "PING\r\n"},
+//       {"read": "line"},
+//       {"expect": {"prefix": "+PONG"}},
+//       {"send": "INFO server\r\n"},
+//       {"read": "until", "delim": "\r\n\r\n"},
+//       {"extract": "version", "regex": "redis_version:([^\\r\\n]+)"}
+//     ]
+//   }
+//
+// 步骤：
+//   send     发送载荷；除 JSON 自身转义外，"\\xHH" 表示任意字节
+//   read     line | reply（"ddd-" 多行应答）| until（delim）| some | exact（bytes）
+//   expect   对最近一次读到的数据匹配 prefix / contains / regex；"else": "fail"（默认）| "done"
+//   extract  对最近一次读到的数据做正则匹配，第 1 个分组存入 attrs.fields[name]
+//   banner   把最近一次读到数据的首行（可打印字符）作为 banner
+//   settle   此后的步骤失败或超时不再否定本次探测
+// 首步为 read 且紧跟 expect 的定义视为服务端先发言，可加入同端口的 banner 共享连接（见 banner_mux.h）。
+
+enum class ProbeOp : uint8_t {
+    Send,
+    ReadLine,
+    ReadReply,
+    ReadUntil,
+    ReadSome,
+    ReadExact,
+    ExpectPrefix,
+    ExpectContains,
+    ExpectRegex,
+    Extract,
+    Banner,
+    Settle,
+};
+
+// 不匹配时的去向
+enum class ProbeMiss : uint8_t { Fail, Done };
+
+// 一条指令 8 字节：arg 为常量 / 正则 / 字段下标，len 为字节数或第二个下标
+struct ProbeInstr {
+    ProbeOp op;
+    ProbeMiss miss = ProbeMiss::Fail;
+    uint16_t arg = 0;
+    uint32_t len = 0;
+};
+
+struct ProbeProgram {
+    std::string name;
+    bool enabled = false;
+    std::vector<Port> ports;
+    std::vector<Port> tls_ports;
+    Timeout timeout{3000};
+
+    std::vector<ProbeInstr> code;
+    std::vector<std::string> constants;   // 载荷、前缀、分隔符（已反转义）
+    std::vector<std::regex> patterns;
+    std::vector<std::string> fields;      // extract 的字段名
+
+    // 服务端先发言时用于欢迎消息打分的 expect 指令下标，-1 表示不参与 banner 共享
+    int greeting_check = -1;
+
+    bool server_first() const { return greeting_check >= 0; }
+
+    // 对数据执行一条 expect 指令
+    bool matches(const ProbeInstr& in, std::string_view data) const;
+};
+
+// 读取定义文件（{"probes": [...]}）并逐个编译；非法定义记录错误（含出错步骤）后跳过，
+// 文件不存在时返回空
+std::vector<std::shared_ptr<const ProbeProgram>> load_probe_definitions(const std::string& path);
+
+} // namespace scanner
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "scanner/common/probe_pool.h"
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+namespace scanner {
+
+// =====================
+// 探测协程
+// =====================
+// 惰性启动的协程类型，协程帧从 ProbePool 分配。
+// 可作为根协程由 ProbeEngine 启动，也可在另一个 ProbeTask 中 co_await（对称转移，不占用调用栈）。
+// ProbeTask 拥有其协程帧：销毁 ProbeTask 即销毁帧，挂起中的子协程随父帧一并销毁。
+
+class [[nodiscard]] ProbeTask {
+public:
+    struct promise_type;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(handle_type h) noexcept {
+            auto next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    struct promise_type {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        ProbeTask get_return_object() noexcept { return ProbeTask(handle_type::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+
+        static void* operator new(std::size_t size) { return ProbePool::allocate(size); }
+        static void operator delete(void* p, std::size_t size) noexcept { ProbePool::deallocate(p, size); }
+    };
+
+    ProbeTask() noexcept = default;
+    ProbeTask(ProbeTask&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    ProbeTask& operator=(ProbeTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    ProbeTask(const ProbeTask&) = delete;
+    ProbeTask& operator=(const ProbeTask&) = delete;
+    ~ProbeTask() { reset(); }
+
+    // 作为根协程启动
+    void start() {
+        if (handle_ && !handle_.done()) handle_.resume();
+    }
+
+    // 作为子协程被等待；子协程抛出的异常在父协程中重新抛出
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        handle_.promise().continuation = caller;
+        return handle_;
+    }
+    void await_resume() const {
+        if (handle_ && handle_.promise().error) {
+            std::rethrow_exception(handle_.promise().error);
+        }
+    }
+
+private:
+    explicit ProbeTask(handle_type h) noexcept : handle_(h) {}
+
+    void reset() noexcept {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = {};
+        }
+    }
+
+    handle_type handle_;
+};
+
+} // namespace scanner
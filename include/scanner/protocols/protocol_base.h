@@ -1,6 +1,8 @@
 #pragma once
 
+#include <array>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 #include <chrono>
@@ -66,12 +68,66 @@ struct ProtocolAttributes {
         int status_code = 0;
     } http;
 
+    // SSH 属性（服务端 KEXINIT，算法列表取服务端到客户端方向）
+    struct {
+        bool kexinit = false;                 // 是否读到 KEXINIT
+        std::array<uint8_t, 16> hassh{};      // HASSH-server：MD5("kex;ciphers;macs;compression")
+        std::string kex;
+        std::string host_key;
+        std::string ciphers;
+        std::string macs;
+        std::string compression;
+    } ssh;
+
+    // TLS 属性（隐式 TLS 端口或 STARTTLS 升级）
+    struct {
+        bool enabled = false;         // 是否完成 TLS 握手
+        bool starttls = false;        // 是否经 STARTTLS/STLS 在明文连接上升级
+        bool resumed = false;         // 是否为会话恢复
+        std::string version;
+        std::string cipher;
+        uint32_t cert_id = 0;         // CertificateCache 中的证书 ID，0 表示无证书
+        std::string cert_der;         // 握手时拷贝的原始证书，登记后清空
+    } tls;
+
+    // 服务识别（service_probes.h）结果，name 为空表示未识别
+    struct {
+        std::string name;             // 服务名（match/softmatch 的第一个字段）
+        std::string probe;            // 命中时发送的探测名
+        std::string product;
+        std::string version;
+        std::string info;
+        std::string hostname;
+        std::string os;
+        std::string device;
+        std::vector<std::string> cpe;
+        bool soft = false;            // 仅 softmatch：只知道服务，不知道产品
+    } service;
+
+    // 脚本探测（probe_script.h）提取的字段，按定义顺序
+    std::vector<std::pair<std::string, std::string>> fields;
+
     // 通用属性
     std::string banner;           // 服务欢迎消息
     std::string vendor;          // 服务商标识
     double response_time_ms = 0.0; // 响应时间
 };
 
+// 探测因接收预算被提前放弃的类别（见 probe_engine.h）
+enum class BudgetTrip : uint8_t {
+    None,
+    Bytes,   // 单行 / 响应头超过接收缓冲，或累计接收超过字节上限
+    Rate,    // 接收速率低于下限（逐字节滴灌）
+};
+
+inline const char* to_string(BudgetTrip trip) {
+    switch (trip) {
+        case BudgetTrip::Bytes: return "bytes";
+        case BudgetTrip::Rate: return "rate";
+        default: return "";
+    }
+}
+
 // 协议探测结果
 struct ProtocolResult {
     std::string protocol;        // 协议名称 (SMTP, POP3, IMAP, HTTP)
@@ -80,6 +136,8 @@ struct ProtocolResult {
     bool accessible = false;     // 是否可访问
     ProtocolAttributes attrs;    // 协议属性
     std::string error;          // 错误信息
+    BudgetTrip budget = BudgetTrip::None;  // 超出接收预算而提前结束时的类别（已有结果时仍判定成功）
+    std::string raw;            // 探测时只拷贝、留给 IProtocol::enrich 在 CPU 线程池上解析的原始应答
 };
 
 // 扫描目标
@@ -95,8 +153,11 @@ struct ScanReport {
     ScanTarget target;
     std::vector<ProtocolResult> protocols;
     std::chrono::milliseconds total_time;
+    std::string tarpit;         // 判定为 tarpit / 全端口接受的原因，空表示未判定（见 ScanSession）
 };
 
+struct ProbeConnection;  // 已建立的连接，定义见 probe_engine.h
+
 // =====================
 // 协议基类接口
 // =====================
@@ -130,10 +191,64 @@ public:
         ProtocolAttributes& attrs
     ) = 0;
 
-    // 是否需要加密连接
+    // 结果后处理（CPU 线程池，见 enrich_stage.h）：解析探测时留在 r.raw 中的原始应答，
+    // 不影响对话走向的解析放在这里，IO 线程只做拷贝。仅在 r.raw 非空时调用
+    virtual void enrich(ProtocolResult& /*r*/) const {}
+
+    // 是否为隐式 TLS 端口：连接后直接握手，不做明文尝试（587 为 STARTTLS 提交端口，仍走明文）
     virtual bool requires_tls(Port port) const {
-        return (port == 465 || port == 587 || port == 993 || port == 995);
+        return (port == 465 || port == 993 || port == 995);
+    }
+
+    // 传输层为 UDP（见 udp_hub.h）：不参与 TCP 端口预扫与 Banner 复用，默认端口直接探测
+    virtual bool datagram() const { return false; }
+
+    // ====== 服务端先发言的协议 ======
+    // 这类协议连接后先读服务端欢迎消息，可在同一端口上共用一次连接（见 banner_mux.h）
+
+    virtual bool server_speaks_first() const { return false; }
+
+    // 对欢迎消息（首段数据）打分：0 不匹配，1 仅格式相符（如通用的 "220"），2 明确匹配
+    virtual int match_greeting(std::string_view /*greeting*/) const { return 0; }
+
+    // 空闲催促：扫描非默认端口时连接后空闲 idle 仍无欢迎消息，就写出 payload（须为静态存储）再等 idle，
+    // 仍无数据即提前结束，有应答则按应答归类后结束（对端是等客户端先发言的服务）。见 probe_engine.h
+    void set_idle_nudge(Timeout idle, std::string_view payload) {
+        idle_nudge_ = idle;
+        idle_nudge_payload_ = payload;
+    }
+
+    // 本协议在 port 上的空闲阈值；默认端口上等到超时为止，返回 0
+    Timeout idle_nudge(Port port) const {
+        if (idle_nudge_.count() == 0 || !server_speaks_first()) return Timeout(0);
+        const auto defaults = default_ports();
+        for (auto d : defaults) {
+            if (d == port) return Timeout(0);
+        }
+        return idle_nudge_;
     }
+
+    std::string_view idle_nudge_payload() const { return idle_nudge_payload_; }
+
+    // 在已建立、已收到欢迎消息的连接上继续本协议的对话
+    virtual void async_probe_connected(
+        ProbeConnection&& /*conn*/,
+        const std::string& target,
+        Port port,
+        Timeout /*timeout*/,
+        std::function<void(ProtocolResult&&)> on_complete
+    ) {
+        ProtocolResult r;
+        r.protocol = name();
+        r.host = target;
+        r.port = port;
+        r.error = "Connection hand-off not supported";
+        on_complete(std::move(r));
+    }
+
+private:
+    Timeout idle_nudge_{0};
+    std::string_view idle_nudge_payload_;
 };
 
 // =====================
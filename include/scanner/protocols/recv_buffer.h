@@ -0,0 +1,249 @@
+#pragma once
+
+#include "scanner/common/probe_pool.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+namespace scanner {
+
+// =====================
+// 定长接收缓冲
+// =====================
+// 单次探测的接收区，容量固定，首次读取时从 ProbePool 取一块。
+// [begin_, end_) 为未消费数据；行与分隔符用 memchr 查找，结果是指向缓冲内部的 string_view。
+// 消费只移动读指针，数据只在下一次 prepare() 整理空间时才会移动，
+// 因此返回的视图在发起下一次读之前一直有效。
+// 容量即单行 / 单个响应头的上限；累计接收字节另设硬上限，防止对端无限输出。
+
+class RecvBuffer {
+public:
+    static constexpr std::size_t kCapacity = 4096;
+    static constexpr std::size_t kMaxTotalBytes = 64 * 1024;
+
+    RecvBuffer() = default;
+    ~RecvBuffer() {
+        if (data_) ProbePool::deallocate(data_, kCapacity);
+    }
+    RecvBuffer(const RecvBuffer&) = delete;
+    RecvBuffer& operator=(const RecvBuffer&) = delete;
+
+    // 移动时连同未消费数据一起转交（连接在协议之间交接时使用）
+    RecvBuffer(RecvBuffer&& other) noexcept { swap(other); }
+    RecvBuffer& operator=(RecvBuffer&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    std::string_view data() const { return std::string_view(data_ + begin_, end_ - begin_); }
+    std::size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+
+    // 累计接收字节是否超过硬上限
+    bool over_limit() const { return total_ > kMaxTotalBytes; }
+
+    // 返回首个完整行的长度（含 '\n'），没有完整行时返回 npos。
+    // 已扫描过的区间不再重复扫描。
+    std::size_t find_line() {
+        std::size_t from = std::max(scanned_, begin_);
+        const void* nl = from < end_ ? std::memchr(data_ + from, '\n', end_ - from) : nullptr;
+        if (!nl) {
+            scanned_ = end_;
+            return std::string_view::npos;
+        }
+        return static_cast<const char*>(nl) - (data_ + begin_) + 1;
+    }
+
+    // 返回到分隔符末尾为止的长度，未找到时返回 npos
+    std::size_t find(std::string_view delim) {
+        std::size_t overlap = delim.empty() ? 0 : delim.size() - 1;
+        std::size_t from = std::max(scanned_ > overlap ? scanned_ - overlap : 0, begin_);
+        auto pos = data().find(delim, from - begin_);
+        if (pos == std::string_view::npos) {
+            scanned_ = end_;
+            return pos;
+        }
+        return pos + delim.size();
+    }
+
+    // 返回一个完整的多行应答（SMTP / FTP 风格："250-..." 续行，"250 ..." 结束）的长度，
+    // 含结束行的 '\n'；结束行尚未到达时返回 npos。
+    // 只有 "三位数字 + '-'" 开头的行算续行，其余行（包括不合规的行）都视为结束，避免空等到超时。
+    // 应答通常一次到达，这里每次从头逐行检查，不保留中间状态。
+    std::size_t find_reply() const {
+        std::size_t pos = begin_;
+        while (pos < end_) {
+            const void* nl = std::memchr(data_ + pos, '\n', end_ - pos);
+            if (!nl) return std::string_view::npos;
+            std::size_t next = static_cast<const char*>(nl) - data_ + 1;
+            const char* line = data_ + pos;
+            bool continued = next - pos > 4 && line[3] == '-' &&
+                             std::isdigit(static_cast<unsigned char>(line[0])) &&
+                             std::isdigit(static_cast<unsigned char>(line[1])) &&
+                             std::isdigit(static_cast<unsigned char>(line[2]));
+            if (!continued) return next - begin_;
+            pos = next;
+        }
+        return std::string_view::npos;
+    }
+
+    void consume(std::size_t n) {
+        begin_ += std::min(n, size());
+        if (begin_ == end_) {
+            begin_ = end_ = scanned_ = 0;
+        }
+    }
+
+    // 丢弃全部数据并清零累计字节（连接重建时使用），保留已分配的存储
+    void reset() {
+        begin_ = end_ = scanned_ = total_ = 0;
+    }
+
+    // 为下一次读准备可写空间并返回可写字节数；尾部已满时把未消费数据移到开头。
+    // 返回 0 表示未消费数据已占满整个缓冲（单行超过容量）。
+    std::size_t prepare() {
+        if (!data_) {
+            data_ = static_cast<char*>(ProbePool::allocate(kCapacity));
+        }
+        if (end_ == kCapacity && begin_ > 0) {
+            std::memmove(data_, data_ + begin_, end_ - begin_);
+            scanned_ -= std::min(scanned_, begin_);
+            end_ -= begin_;
+            begin_ = 0;
+        }
+        return kCapacity - end_;
+    }
+
+    char* tail() { return data_ + end_; }
+
+    void commit(std::size_t n) {
+        end_ += n;
+        total_ += n;
+    }
+
+private:
+    void swap(RecvBuffer& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(begin_, other.begin_);
+        std::swap(end_, other.end_);
+        std::swap(scanned_, other.scanned_);
+        std::swap(total_, other.total_);
+    }
+
+    char* data_ = nullptr;
+    std::size_t begin_ = 0;
+    std::size_t end_ = 0;
+    std::size_t scanned_ = 0;  // 此前查找已覆盖到的位置
+    std::size_t total_ = 0;    // 累计接收字节
+};
+
+// =====================
+// 定长 Banner 存储
+// =====================
+// Banner 在对话中就地拼装，超出容量的部分截断，探测结束时一次写入结果。
+
+class BannerStore {
+public:
+    static constexpr std::size_t kCapacity = 256;
+
+    void assign(std::string_view s) {
+        size_ = 0;
+        append(s);
+    }
+
+    void append(std::string_view s) {
+        std::size_t n = std::min(s.size(), kCapacity - size_);
+        std::memcpy(data_.data() + size_, s.data(), n);
+        size_ += n;
+    }
+
+    std::string_view view() const { return std::string_view(data_.data(), size_); }
+    bool empty() const { return size_ == 0; }
+
+private:
+    std::array<char, kCapacity> data_;
+    std::size_t size_ = 0;
+};
+
+// =====================
+// 文本工具
+// =====================
+
+// 从 text 头部切出一行（去掉行尾 "\r\n"），text 前移到下一行；text 为空时返回 false。
+
+inline bool next_line(std::string_view& text, std::string_view& line) {
+    if (text.empty()) return false;
+    const void* nl = std::memchr(text.data(), '\n', text.size());
+    std::size_t len = nl ? static_cast<const char*>(nl) - text.data() : text.size();
+    line = text.substr(0, len);
+    text.remove_prefix(nl ? len + 1 : len);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return true;
+}
+
+// 不区分大小写的子串查找，needle 须为小写
+inline std::size_t find_ignore_case(std::string_view haystack, std::string_view needle) {
+    auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+                          [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+    return it == haystack.end() ? std::string_view::npos : static_cast<std::size_t>(it - haystack.begin());
+}
+
+// 不区分大小写地一次扫描查找多个子串（needle 须为小写且非空，最多 32 个）。
+// 结果与按 needles 顺序依次调用 find_ignore_case、取第一个命中者相同，但 haystack 只扫一遍：
+// 每个字节查一次首字符表，只在可能的起点上比较候选 needle；命中后只再找排在它前面的 needle。
+template <std::size_t N>
+class NeedleSet {
+    static_assert(N > 0 && N <= 32);
+
+public:
+    struct Match {
+        std::size_t index = N;                        // 命中的 needle 下标，N 表示都未出现
+        std::size_t pos = std::string_view::npos;
+    };
+
+    constexpr explicit NeedleSet(const std::array<std::string_view, N>& needles) : needles_(needles) {
+        for (std::size_t i = 0; i < N; ++i) {
+            auto c = static_cast<unsigned char>(needles[i][0]);
+            first_[c] |= 1u << i;
+            if (c >= 'a' && c <= 'z') first_[c - 'a' + 'A'] |= 1u << i;
+        }
+    }
+
+    Match find(std::string_view haystack) const {
+        Match best;
+        uint32_t pending = N == 32 ? ~0u : (1u << N) - 1;   // 仍可能改变结果的 needle
+
+        for (std::size_t i = 0; i < haystack.size() && pending; ++i) {
+            uint32_t m = first_[static_cast<unsigned char>(haystack[i])] & pending;
+            while (m) {
+                unsigned k = static_cast<unsigned>(__builtin_ctz(m));
+                m &= m - 1;
+                if (matches_at(haystack, i, needles_[k])) {
+                    best = Match{k, i};
+                    pending &= (1u << k) - 1;   // 之后只有排在它前面的 needle 才能取代它
+                    break;
+                }
+            }
+        }
+        return best;
+    }
+
+private:
+    static bool matches_at(std::string_view h, std::size_t i, std::string_view needle) {
+        if (h.size() - i < needle.size()) return false;
+        for (std::size_t k = 1; k < needle.size(); ++k) {
+            if (std::tolower(static_cast<unsigned char>(h[i + k])) != needle[k]) return false;
+        }
+        return true;
+    }
+
+    std::array<std::string_view, N> needles_;
+    std::array<uint32_t, 256> first_{};
+};
+
+} // namespace scanner
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "protocol_base.h"
+#include "probe_script.h"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <memory>
+#include <string_view>
+
+namespace scanner {
+
+// =====================
+// 脚本协议
+// =====================
+// 由 probe_script.h 的定义编译而来；所有脚本协议共用同一个字节码解释器。
+
+class ScriptedProtocol : public IProtocol {
+public:
+    explicit ScriptedProtocol(std::shared_ptr<const ProbeProgram> program)
+        : program_(std::move(program)) {}
+
+    std::string name() const override { return program_->name; }
+
+    std::vector<Port> default_ports() const override { return program_->ports; }
+
+    Timeout default_timeout() const override { return program_->timeout; }
+
+    bool requires_tls(Port port) const override {
+        const auto& tls = program_->tls_ports;
+        return std::find(tls.begin(), tls.end(), port) != tls.end();
+    }
+
+    void async_probe(
+        const std::string& target,
+        const std::string& ip,
+        Port port,
+        Timeout timeout,
+        boost::asio::any_io_executor exec,
+        std::function<void(ProtocolResult&&)> on_complete
+    ) override;
+
+    void parse_capabilities(const std::string&, ProtocolAttributes&) override {}
+
+    bool server_speaks_first() const override { return program_->server_first(); }
+
+    int match_greeting(std::string_view greeting) const override;
+
+    void async_probe_connected(
+        ProbeConnection&& conn,
+        const std::string& target,
+        Port port,
+        Timeout timeout,
+        std::function<void(ProtocolResult&&)> on_complete
+    ) override;
+
+private:
+    class Probe;
+
+    std::shared_ptr<const ProbeProgram> program_;
+};
+
+} // namespace scanner
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "protocol_base.h"
+#include "../vendor/service_probes.h"
+#include <boost/asio.hpp>
+#include <memory>
+
+namespace scanner {
+
+// =====================
+// 服务识别协议（SERVICE）
+// =====================
+// 按 ServiceProbeDb::probes_for 为端口挑选探测，逐个新建连接发送载荷并匹配应答，
+// 首个 match 即结束；都只有 softmatch 或无法识别时，报告 softmatch > 有应答 > 错误中最好的一个。
+// 连接失败时不再尝试后续探测。
+
+class ServiceProtocol : public IProtocol {
+public:
+    ServiceProtocol(std::shared_ptr<const ServiceProbeDb> db, std::vector<Port> ports,
+                    int intensity, std::size_t max_probes)
+        : db_(std::move(db)), ports_(std::move(ports)), intensity_(intensity), max_probes_(max_probes) {
+        if (ports_.empty()) ports_ = db_->declared_ports();
+    }
+
+    std::string name() const override { return "SERVICE"; }
+
+    std::vector<Port> default_ports() const override { return ports_; }
+
+    Timeout default_timeout() const override { return Timeout(5000); }
+
+    bool requires_tls(Port port) const override { return db_->is_ssl_port(port); }
+
+    void async_probe(
+        const std::string& target,
+        const std::string& ip,
+        Port port,
+        Timeout timeout,
+        boost::asio::any_io_executor exec,
+        std::function<void(ProtocolResult&&)> on_complete
+    ) override;
+
+    void parse_capabilities(const std::string&, ProtocolAttributes&) override {}
+
+private:
+    class Probe;
+    class Chain;
+
+    std::shared_ptr<const ServiceProbeDb> db_;
+    std::vector<Port> ports_;
+    int intensity_;
+    std::size_t max_probes_;
+};
+
+} // namespace scanner
@@ -3,6 +3,7 @@
 #include "protocol_base.h"
 #include <boost/asio.hpp>
 #include <string>
+#include <string_view>
 
 namespace scanner {
 
@@ -10,7 +11,6 @@ using boost::asio::ip::tcp;
 using boost::asio::steady_timer;
 namespace asio = boost::asio;
 
-struct ProbeContext;
 class SmtpProtocol : public IProtocol {
 public:
     SmtpProtocol() = default;
@@ -45,10 +45,35 @@ public:
         ProtocolAttributes& attrs
     ) override;
 
+    bool server_speaks_first() const override { return true; }
+
+    int match_greeting(std::string_view greeting) const override;
+
+    void async_probe_connected(
+        ProbeConnection&& conn,
+        const std::string& target,
+        Port port,
+        Timeout timeout,
+        std::function<void(ProtocolResult&&)> on_complete
+    ) override;
+
+    // 对端声明 STARTTLS 时在同一连接上升级并记录 TLS 信息（默认关闭）
+    void set_starttls(bool enabled) { starttls_ = enabled; }
+    bool starttls_enabled() const { return starttls_; }
+
+    // 连接后不等欢迎消息就写出后续命令（EHLO），欢迎消息与应答一次往返取回（默认关闭）
+    void set_optimistic(bool enabled) { optimistic_ = enabled; }
+    bool optimistic_enabled() const { return optimistic_; }
+
 private:
-    void parse_ehlo_line(const std::string& line, ProtocolAttributes& attrs);
-    void parse_size(const std::string& value, ProtocolAttributes& attrs);
-    void parse_auth(const std::string& value, ProtocolAttributes& attrs);
+    class Probe;
+
+    bool starttls_ = false;
+    bool optimistic_ = false;
+
+    void parse_ehlo_line(std::string_view line, ProtocolAttributes& attrs) const;
+    void parse_size(std::string_view value, ProtocolAttributes& attrs) const;
+    void parse_auth(std::string_view value, ProtocolAttributes& attrs) const;
 };
 
 } // namespace scanner
@@ -2,6 +2,7 @@
 
 #include "protocol_base.h"
 #include <boost/asio.hpp>
+#include <string_view>
 
 namespace scanner {
 
@@ -36,6 +37,27 @@ public:
         const std::string& response,
         ProtocolAttributes& attrs
     ) override;
+
+    bool server_speaks_first() const override { return true; }
+
+    int match_greeting(std::string_view greeting) const override;
+
+    // 解析留存的 KEXINIT 载荷：算法列表与 HASSH
+    void enrich(ProtocolResult& r) const override;
+
+    void async_probe_connected(
+        ProbeConnection&& conn,
+        const std::string& target,
+        Port port,
+        Timeout timeout,
+        std::function<void(ProtocolResult&&)> on_complete
+    ) override;
+
+private:
+    class Probe;
+
+    // 解析 SSH_MSG_KEXINIT 载荷（含消息类型字节），name-list 以视图读取，只复制要保留的列表
+    bool parse_kexinit(std::string_view payload, ProtocolAttributes& attrs) const;
 };
 
 } // namespace scanner
@@ -2,6 +2,7 @@
 
 #include "protocol_base.h"
 #include <boost/asio.hpp>
+#include <string_view>
 
 namespace scanner {
 
@@ -36,6 +37,21 @@ public:
         const std::string& response,
         ProtocolAttributes& attrs
     ) override;
+
+    bool server_speaks_first() const override { return true; }
+
+    int match_greeting(std::string_view greeting) const override;
+
+    void async_probe_connected(
+        ProbeConnection&& conn,
+        const std::string& target,
+        Port port,
+        Timeout timeout,
+        std::function<void(ProtocolResult&&)> on_complete
+    ) override;
+
+private:
+    class Probe;
 };
 
 } // namespace scanner
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "protocol_base.h"
+#include <boost/asio/ssl.hpp>
+#include <openssl/ssl.h>
+#include <string>
+#include <string_view>
+
+namespace scanner {
+
+// =====================
+// TLS 客户端上下文
+// =====================
+// 每个 IO 线程一个 SSL_CTX，首次使用时创建，同线程上的所有 TLS 探测共用，无需加锁。
+// 扫描只关心对端身份与能力，不校验证书链（verify_none），证书由 tls_inspect_certificate 离线解析。
+
+boost::asio::ssl::context& tls_client_context();
+
+// =====================
+// TLS 会话缓存
+// =====================
+// 同样按线程划分，以 "ip:port" 为键保存最近一次拿到的会话（TLS 1.3 下为握手后到达的票据），
+// 对同一主机的后续探测（重复目标、重复端口）尝试会话恢复，省去完整握手。
+// 条目数有上限，超出时淘汰最早插入的条目。
+
+// 会话所属的对端；由探测上下文持有，生命周期覆盖对应的 SSL 对象
+struct TlsPeer {
+    std::string_view ip;
+    Port port = 0;
+};
+
+// 握手前配置 SSL 对象：绑定对端（新会话到达时据此入缓存）、设置 SNI（仅域名）、装入可恢复的会话
+void tls_prepare_client(SSL* ssl, const TlsPeer& peer, const std::string& server_name);
+
+// =====================
+// 证书解析
+// =====================
+// 握手完成时 IO 线程只把对端证书的 DER 拷贝进 attrs.tls.cert_der；
+// 由 CPU 线程池调用本函数登记到 CertificateCache（见 cert_cache.h）得到 cert_id，随后清空 cert_der。
+
+void tls_inspect_certificate(ProtocolAttributes& attrs);
+
+} // namespace scanner
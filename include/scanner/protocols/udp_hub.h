@@ -0,0 +1,165 @@
+#pragma once
+
+#include "protocol_base.h"
+#include <boost/asio.hpp>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace scanner {
+
+namespace asio = boost::asio;
+
+// =====================
+// UDP 协议基类
+// =====================
+// 一问一答的 UDP 探测：请求里带事务 ID，应答按 (源地址, 源端口, 事务 ID) 找回对应的探测。
+// 子类只描述报文（构造请求、取应答的事务 ID、解析应答），收发与超时由 UdpHub 统一处理。
+
+class UdpProtocol : public IProtocol {
+public:
+    static constexpr std::size_t kMaxRequest = 512;
+
+    bool datagram() const override { return true; }
+
+    bool requires_tls(Port) const override { return false; }
+
+    void async_probe(
+        const std::string& target,
+        const std::string& ip,
+        Port port,
+        Timeout timeout,
+        boost::asio::any_io_executor exec,
+        std::function<void(ProtocolResult&&)> on_complete
+    ) override;
+
+    void parse_capabilities(const std::string&, ProtocolAttributes&) override {}
+
+    // 事务 ID 的有效位；0 表示报文里没有事务 ID（同一端点同时只能有一个请求）
+    virtual uint32_t txid_mask() const = 0;
+
+    // 把带 txid 的请求写入 buf（至少 kMaxRequest 字节），返回长度
+    virtual std::size_t build_request(uint32_t txid, const std::string& target, unsigned char* buf) const = 0;
+
+    // 应答是否属于本协议；是则取出事务 ID
+    virtual bool response_txid(std::string_view data, uint32_t& txid) const = 0;
+
+    // 解析应答，填充 banner / fields
+    virtual void parse_response(std::string_view data, ProtocolAttributes& attrs) const = 0;
+};
+
+// =====================
+// UDP 收发中枢
+// =====================
+// 每个 IO 线程一个（线程局部，首次使用时创建），只在该线程上访问，无需加锁：
+//   - 每个地址族 kSocketsPerFamily 个未连接的 UDP 套接字，请求轮流分配
+//   - 同一轮事件循环里提交的请求攒在发送队列里，由一次 sendmmsg 批量发出
+//   - 可读时用 recvmmsg 批量收包，按 (源地址, 源端口, 事务 ID) 在哈希表中找回探测
+//   - 每个套接字一个定时器和一个按到期时间排序的堆，只在最早的期限上等待，
+//     而不是每个请求一个 steady_timer
+
+class UdpHub {
+public:
+    // 当前 IO 线程的实例；exec 必须是当前线程的执行器
+    static UdpHub& local(const asio::any_io_executor& exec);
+
+    explicit UdpHub(const asio::any_io_executor& exec);
+    ~UdpHub();
+
+    UdpHub(const UdpHub&) = delete;
+    UdpHub& operator=(const UdpHub&) = delete;
+
+    void submit(const UdpProtocol& proto, const asio::ip::address& addr, Port port, const std::string& target,
+                Timeout timeout, std::function<void(ProtocolResult&&)> on_complete);
+
+private:
+    static constexpr std::size_t kSocketsPerFamily = 4;
+
+    struct FlowKey {
+        std::array<unsigned char, 16> addr{};
+        Port port = 0;
+        uint32_t txid = 0;
+
+        bool operator==(const FlowKey& o) const {
+            return port == o.port && txid == o.txid && addr == o.addr;
+        }
+    };
+
+    struct FlowKeyHash {
+        std::size_t operator()(const FlowKey& k) const;
+    };
+
+    struct Pending {
+        const UdpProtocol* proto = nullptr;
+        uint64_t id = 0;
+        Timeout timeout{0};
+        std::chrono::steady_clock::time_point sent_at;
+        ProtocolResult result;
+        std::function<void(ProtocolResult&&)> on_complete;
+    };
+
+    struct Outgoing {
+        FlowKey key;
+        uint64_t id = 0;
+        asio::ip::udp::endpoint to;
+        std::size_t len = 0;
+        std::array<unsigned char, UdpProtocol::kMaxRequest> data;
+    };
+
+    struct Deadline {
+        std::chrono::steady_clock::time_point at;
+        FlowKey key;
+        uint64_t id = 0;
+
+        bool operator>(const Deadline& o) const { return at > o.at; }
+    };
+
+    struct Slot {
+        Slot(const asio::any_io_executor& exec, const asio::ip::udp& family);
+
+        asio::ip::udp::socket socket;
+        asio::steady_timer timer;
+        std::vector<Outgoing> sendq;
+        bool flush_scheduled = false;
+        bool waiting_write = false;
+        std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines;
+    };
+
+    static FlowKey make_key(const asio::ip::address& addr, Port port, uint32_t txid);
+
+    // 轮流选取地址族的套接字，首次使用时创建；无法创建时返回空
+    Slot* pick_slot(bool v6);
+    void schedule_flush(Slot& slot);
+    void flush(Slot& slot);
+    void arm_deadline(Slot& slot, const FlowKey& key, uint64_t id, std::chrono::steady_clock::time_point at);
+    void expire(Slot& slot);
+    void wait_readable(Slot& slot);
+    void drain(Slot& slot);
+    void handle_datagram(const asio::ip::address& from, Port port, std::string_view data);
+
+    // 以错误结束仍在等待的请求（id 对不上说明已结束）；error 为空表示超时
+    void fail(const FlowKey& key, uint64_t id, std::string error);
+
+    asio::any_io_executor exec_;
+    std::vector<std::unique_ptr<Slot>> v4_;
+    std::vector<std::unique_ptr<Slot>> v6_;
+    std::size_t next_v4_ = 0;
+    std::size_t next_v6_ = 0;
+
+    std::unordered_map<FlowKey, Pending, FlowKeyHash> pending_;
+    // 某源端口上可能出现应答的协议（通常只有一个），收包时据此取事务 ID
+    std::unordered_map<Port, std::vector<const UdpProtocol*>> protocols_by_port_;
+    uint32_t next_txid_;
+    uint64_t next_id_ = 1;
+
+    std::vector<unsigned char> recv_buf_;   // recvmmsg 的批量接收缓冲
+};
+
+} // namespace scanner
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "udp_hub.h"
+
+namespace scanner {
+
+// =====================
+// UDP 协议
+// =====================
+// 结果写入 attrs.banner 与 attrs.fields；都不在默认协议之列，
+// 由 --protocols 点名或配置 udp.protocols 启用。
+
+// DNS：CHAOS 类 TXT 查询 version.bind，事务 ID 为报文头 ID
+class DnsVersionProtocol : public UdpProtocol {
+public:
+    std::string name() const override { return "DNS"; }
+    std::vector<Port> default_ports() const override { return {53}; }
+    Timeout default_timeout() const override { return Timeout(2000); }
+
+    uint32_t txid_mask() const override { return 0xffff; }
+    std::size_t build_request(uint32_t txid, const std::string& target, unsigned char* buf) const override;
+    bool response_txid(std::string_view data, uint32_t& txid) const override;
+    void parse_response(std::string_view data, ProtocolAttributes& attrs) const override;
+};
+
+// NTP 控制报文（mode 6）READVAR，事务 ID 为序列号
+class NtpProtocol : public UdpProtocol {
+public:
+    std::string name() const override { return "NTP"; }
+    std::vector<Port> default_ports() const override { return {123}; }
+    Timeout default_timeout() const override { return Timeout(2000); }
+
+    uint32_t txid_mask() const override { return 0xffff; }
+    std::size_t build_request(uint32_t txid, const std::string& target, unsigned char* buf) const override;
+    bool response_txid(std::string_view data, uint32_t& txid) const override;
+    void parse_response(std::string_view data, ProtocolAttributes& attrs) const override;
+};
+
+// NTP 私有报文（mode 7）REQ_PEER_LIST：有应答即说明 ntpd 仍开放 mode 7（monlist 放大面），
+// 事务 ID 为 7 位序列号
+class NtpPrivateProtocol : public UdpProtocol {
+public:
+    std::string name() const override { return "NTP_PRIVATE"; }
+    std::vector<Port> default_ports() const override { return {123}; }
+    Timeout default_timeout() const override { return Timeout(2000); }
+
+    uint32_t txid_mask() const override { return 0x7f; }
+    std::size_t build_request(uint32_t txid, const std::string& target, unsigned char* buf) const override;
+    bool response_txid(std::string_view data, uint32_t& txid) const override;
+    void parse_response(std::string_view data, ProtocolAttributes& attrs) const override;
+};
+
+// SNMPv2c GetRequest sysDescr.0（团体名 public），事务 ID 为 request-id
+class SnmpProtocol : public UdpProtocol {
+public:
+    std::string name() const override { return "SNMP"; }
+    std::vector<Port> default_ports() const override { return {161}; }
+    Timeout default_timeout() const override { return Timeout(2000); }
+
+    uint32_t txid_mask() const override { return 0x7fffffff; }
+    std::size_t build_request(uint32_t txid, const std::string& target, unsigned char* buf) const override;
+    bool response_txid(std::string_view data, uint32_t& txid) const override;
+    void parse_response(std::string_view data, ProtocolAttributes& attrs) const override;
+};
+
+// SSDP 单播 M-SEARCH（ST: upnp:rootdevice）；报文没有事务 ID
+class SsdpProtocol : public UdpProtocol {
+public:
+    std::string name() const override { return "SSDP"; }
+    std::vector<Port> default_ports() const override { return {1900}; }
+    Timeout default_timeout() const override { return Timeout(2000); }
+
+    uint32_t txid_mask() const override { return 0; }
+    std::size_t build_request(uint32_t txid, const std::string& target, unsigned char* buf) const override;
+    bool response_txid(std::string_view data, uint32_t& txid) const override;
+    void parse_response(std::string_view data, ProtocolAttributes& attrs) const override;
+};
+
+} // namespace scanner
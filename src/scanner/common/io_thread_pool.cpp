@@ -32,6 +32,11 @@ asio::io_context& IoThreadPool::get_context() {
     return *contexts_[idx];
 }
 
+asio::io_context& IoThreadPool::next_context() {
+    auto idx = rr_.fetch_add(1, std::memory_order_relaxed) % contexts_.size();
+    return *contexts_[idx];
+}
+
 IoThreadPool::TrackingExecutor IoThreadPool::get_tracking_executor() {
     auto idx = choose_least_loaded_index();
     return TrackingExecutor(contexts_[idx]->get_executor(), pending_tasks_[idx]);
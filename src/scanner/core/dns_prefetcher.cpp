@@ -0,0 +1,177 @@
+#include "scanner/core/dns_prefetcher.h"
+#include "scanner/common/logger.h"
+#include <algorithm>
+#include <cmath>
+
+namespace scanner {
+
+namespace {
+// 无样本时假设的 DNS 时延
+constexpr double kDefaultDnsMs = 100.0;
+// 窗口余量系数：覆盖时延抖动
+constexpr double kWindowHeadroom = 1.5;
+// 平滑系数
+constexpr double kEwmaAlpha = 0.2;
+// 准入速率采样周期
+constexpr auto kRatePeriod = std::chrono::milliseconds(250);
+// 与原 ScanSession 同步解析保持一致的重试次数
+constexpr int kMaxRetries = 2;
+} // namespace
+
+DnsPrefetcher::DnsPrefetcher(size_t workers, Timeout dns_timeout, size_t min_window, size_t max_window)
+    : dns_timeout_(dns_timeout),
+      min_window_(std::max<size_t>(1, min_window)),
+      max_window_(std::max(max_window, std::max<size_t>(1, min_window))),
+      period_start_(std::chrono::steady_clock::now()) {
+    workers = std::max<size_t>(1, workers);
+    workers_.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this]() { worker_loop(); });
+    }
+    LOG_DNS_INFO("DNS prefetcher started: workers={} window=[{}, {}]", workers, min_window_, max_window_);
+}
+
+DnsPrefetcher::~DnsPrefetcher() {
+    shutdown();
+}
+
+void DnsPrefetcher::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_) return;
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+    workers_.clear();
+}
+
+size_t DnsPrefetcher::window() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double latency_s = (dns_ewma_ms_ > 0.0 ? dns_ewma_ms_ : kDefaultDnsMs) / 1000.0;
+    double need = std::ceil(rate_ewma_ * latency_s * kWindowHeadroom);
+    auto w = static_cast<size_t>(need);
+    return std::clamp(w, min_window_, max_window_);
+}
+
+size_t DnsPrefetcher::in_window() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size() + resolving_ + ready_.size();
+}
+
+void DnsPrefetcher::submit(ScanTarget target) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!target.ip.empty()) {
+            // 已有 IP，无需解析
+            PrefetchedTarget pt;
+            pt.dns.domain = target.domain;
+            pt.dns.ip = target.ip;
+            pt.dns.success = true;
+            pt.target = std::move(target);
+            ready_.push_back(std::move(pt));
+            return;
+        }
+        pending_.push_back(std::move(target));
+    }
+    cv_.notify_one();
+}
+
+bool DnsPrefetcher::try_take(PrefetchedTarget& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ready_.empty()) {
+        // 槽位已空出但目标仍在解析：记一次未命中（每次停顿只记一次）
+        if ((resolving_ > 0 || !pending_.empty()) && !stalled_) {
+            stalled_ = true;
+            ++misses_;
+        }
+        return false;
+    }
+    out = std::move(ready_.front());
+    ready_.pop_front();
+    // 预取的目标才计入命中，停顿后取到的第一个不计
+    if (out.prefetched && !stalled_) {
+        ++hits_;
+    }
+    stalled_ = false;
+    record_admission();
+    return true;
+}
+
+void DnsPrefetcher::record_admission() {
+    ++admissions_in_period_;
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = now - period_start_;
+    if (elapsed < kRatePeriod) return;
+    double secs = std::chrono::duration<double>(elapsed).count();
+    double sample = static_cast<double>(admissions_in_period_) / secs;
+    rate_ewma_ = (rate_ewma_ == 0.0) ? sample : rate_ewma_ + kEwmaAlpha * (sample - rate_ewma_);
+    admissions_in_period_ = 0;
+    period_start_ = now;
+}
+
+DnsPrefetcher::Stats DnsPrefetcher::stats() const {
+    Stats s;
+    s.window = window();
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.hits = hits_;
+    s.misses = misses_;
+    s.resolved = resolved_;
+    s.failed = failed_;
+    s.avg_dns_ms = dns_ewma_ms_;
+    s.admission_rate = rate_ewma_;
+    return s;
+}
+
+void DnsPrefetcher::worker_loop() {
+    // c-ares channel 不是线程安全的：每个工作线程持有独立解析器
+    auto resolver = DnsResolverFactory::create(DnsResolverFactory::ResolverType::C_ARES);
+
+    while (true) {
+        ScanTarget target;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stop_ || !pending_.empty(); });
+            if (stop_) return;
+            target = std::move(pending_.front());
+            pending_.pop_front();
+            ++resolving_;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        PrefetchedTarget pt;
+        pt.prefetched = true;
+        for (int i = 0; i <= kMaxRetries; ++i) {
+            pt.dns = resolver->resolve(target.domain, dns_timeout_);
+            if (!pt.dns.ip.empty()) break;
+            if (i < kMaxRetries) {
+                LOG_DNS_WARN("DNS resolution failed for {}, retrying ({}/{})...",
+                             target.domain, i + 1, kMaxRetries);
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        bool ok = !pt.dns.ip.empty();
+        if (ok) {
+            target.ip = pt.dns.ip;
+        } else {
+            LOG_CORE_ERROR("DNS resolution failed for {} after {} retries", target.domain, kMaxRetries + 1);
+        }
+        pt.target = std::move(target);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        --resolving_;
+        if (ok) {
+            ++resolved_;
+            dns_ewma_ms_ = (dns_ewma_ms_ == 0.0) ? ms : dns_ewma_ms_ + kEwmaAlpha * (ms - dns_ewma_ms_);
+        } else {
+            ++failed_;
+        }
+        ready_.push_back(std::move(pt));
+    }
+}
+
+} // namespace scanner
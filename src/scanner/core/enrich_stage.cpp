@@ -0,0 +1,61 @@
+#include "scanner/core/enrich_stage.h"
+#include "scanner/core/session.h"
+#include <iterator>
+#include <stdexcept>
+
+namespace scanner {
+
+void EnrichStage::post(ScanSession* session, const IProtocol* proto, ProtocolResult&& result) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(Item{session, proto, std::move(result)});
+        if (!scheduled_) {
+            scheduled_ = true;
+            wake = true;
+        }
+    }
+    if (wake) schedule();
+}
+
+void EnrichStage::schedule() {
+    try {
+        pool_.submit([this]() { drain(); });
+    } catch (const std::runtime_error&) {
+        drain();
+    }
+}
+
+void EnrichStage::drain() {
+    std::vector<Item> batch;
+    bool more = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.size() <= kMaxBatch) {
+            batch.swap(pending_);
+            scheduled_ = false;
+        } else {
+            auto end = pending_.begin() + kMaxBatch;
+            batch.assign(std::make_move_iterator(pending_.begin()), std::make_move_iterator(end));
+            pending_.erase(pending_.begin(), end);
+            more = true;
+        }
+    }
+    // 积压超过一批：先交出剩余部分，再处理本批
+    if (more) schedule();
+
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    items_.fetch_add(batch.size(), std::memory_order_relaxed);
+    for (auto& item : batch) {
+        item.session->finish_result(item.proto, std::move(item.result));
+    }
+}
+
+EnrichStage::Stats EnrichStage::stats() const {
+    Stats s;
+    s.items = items_.load(std::memory_order_relaxed);
+    s.batches = batches_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace scanner
@@ -1,9 +1,16 @@
 #include "scanner/core/session.h"
+#include "scanner/core/enrich_stage.h"
 #include "scanner/dns/dns_resolver.h"
 #include "scanner/common/logger.h"
 #include "scanner/network/latency_manager.h"
+#include "scanner/protocols/banner_mux.h"
+#include "scanner/network/port_scanner.h"
+#include "scanner/protocols/tls_context.h"
 #include <atomic>
 #include <algorithm>
+#include <bit>
+#include <functional>
+#include <unordered_set>
 
 namespace scanner {
 
@@ -58,24 +65,69 @@ ScanSession::ScanSession(
     }
 
     probe_mode_ = mode;
+    init_probe_plan(protocols);
+}
+
+ScanSession::ScanSession(
+    const ScanTarget& target,
+    DnsResult prefetched_dns,
+    Timeout probe_timeout,
+    ProbeMode mode,
+    const std::vector<std::unique_ptr<IProtocol>>& protocols
+)
+    : target_(target),
+      dns_timeout_(0),
+      probe_timeout_(probe_timeout),
+      dns_result_(std::move(prefetched_dns)) {
+    if (target_.ip.empty()) {
+        target_.ip = dns_result_.ip;
+    }
+    if (target_.ip.empty() && !target_.domain.empty()) {
+        set_state(State::PENDING, State::FAILED);
+        set_error("DNS Resolution Failed");
+    }
+
+    probe_mode_ = mode;
+    init_probe_plan(protocols);
+}
 
+void ScanSession::init_probe_plan(const std::vector<std::unique_ptr<IProtocol>>& protocols) {
     // 构建 available_ports_（占位：默认使用协议默认端口并集；全扫描未实现时也使用默认端口）
-    for (const auto& p : protocols) {
-        if (!p) continue;
+    // UDP 协议不参与 TCP 端口预扫，其默认端口不计入
+    // 同时记录协议的默认端口与端口族（首个以其为默认端口的协议下标），供 tarpit 判定区分不同服务
+    for (std::size_t i = 0; i < protocols.size(); ++i) {
+        const auto& p = protocols[i];
+        if (!p || p->datagram()) continue;
+        const std::string pname = p->name();
         for (auto d : p->default_ports()) {
+            auto family = static_cast<uint8_t>(std::min<std::size_t>(i, 31));
             if (std::find(available_ports_.begin(), available_ports_.end(), d) == available_ports_.end()) {
                 available_ports_.push_back(d);
+            } else {
+                for (const auto& o : port_owners_) {
+                    if (o.port == d) {
+                        family = o.family;
+                        break;
+                    }
+                }
             }
+            port_owners_.push_back(PortOwner{d, family, pname});
         }
     }
 
+    rebuild_probe_plan(protocols);
+}
+
+void ScanSession::rebuild_probe_plan(const std::vector<std::unique_ptr<IProtocol>>& protocols) {
     init_protocol_queues(protocols);
 
     // 预估任务总数
     std::size_t total_tasks = 0;
     for (const auto& p : protocols) {
         if (!p) continue;
-        if (probe_mode_ == ProbeMode::ProtocolDefaults) {
+        if (p->datagram()) {
+            total_tasks += p->default_ports().size();
+        } else if (probe_mode_ == ProbeMode::ProtocolDefaults) {
             for (auto d : p->default_ports()) {
                 if (should_probe(*p, d)) total_tasks++;
             }
@@ -98,6 +150,30 @@ bool ScanSession::start_one_probe(
         return false;
     }
 
+    // 端口预扫未完成时不启动探测；完成后在扫描线程上按开放端口重建计划
+    switch (sweep_state_.load(std::memory_order_acquire)) {
+        case SweepState::Running:
+            return false;
+        case SweepState::Done:
+            available_ports_ = std::move(open_ports_);
+            sweep_state_.store(SweepState::None, std::memory_order_relaxed);
+            rebuild_probe_plan(protocols);
+            break;
+        case SweepState::None:
+            break;
+    }
+
+    // 已判定为 tarpit：排队中的 TCP 探测不再发起
+    if (!tarpit_cancelled_ && tarpit_.load(std::memory_order_acquire)) {
+        cancel_pending_probes(protocols);
+    }
+
+    // 先启动单连接 Banner 复用任务
+    if (!banner_queue_.empty()) {
+        start_banner_probe(scan_pool, exec, timeout);
+        return true;
+    }
+
     // 找到第一个有待扫端口的协议
     std::string chosen_proto;
     Port chosen_port = 0;
@@ -127,19 +203,8 @@ bool ScanSession::start_one_probe(
         return false;
     }
 
-    // 计算有效超时：优先考虑动态（当全局为0时），并与协议默认超时取最大值
-    Timeout effective_timeout = timeout;
-    if (effective_timeout.count() == 0) {
-        effective_timeout = LatencyManager::instance().get_timeout(target_.ip);
-    }
-    // 按照约定：每个协议的最终超时 = max(协议默认超时, 全局/动态超时)
-    Timeout proto_default = proto_ptr->default_timeout();
-    if (proto_default > effective_timeout) {
-        effective_timeout = proto_default;
-    }
-
     // 提交任务到扫描线程池，实际 IO 在 exec 所属 io_context
-    scan_pool.submit([this, proto_ptr, port = chosen_port, exec, timeout = effective_timeout]() {
+    scan_pool.submit([this, proto_ptr, port = chosen_port, exec, timeout = effective_timeout(*proto_ptr, timeout)]() {
         // 优先使用域名作为 target，如果没有域名则使用 IP
         const std::string& target = target_.domain.empty() ? target_.ip : target_.domain;
         
@@ -149,18 +214,16 @@ bool ScanSession::start_one_probe(
             port,
             timeout,
             exec,
-            [this, proto_name = proto_ptr->name()](ProtocolResult&& r) {
+            // 只捕获两个指针，保持在 std::function 的内联存储内，不额外分配
+            [this, proto_ptr](ProtocolResult&& r) {
                 if (!r.accessible && !r.error.empty()) {
                      // 临时增加调试日志，采样打印错误
                      static int err_log_count = 0;
                      if (err_log_count++ < 10) {
-                         LOG_CORE_WARN("Probe failed for {} {}: {}", target_.ip, proto_name, r.error);
+                         LOG_CORE_WARN("Probe failed for {} {}: {}", target_.ip, proto_ptr->name(), r.error);
                      }
                 }
-                push_result(std::move(r));
-                if (ready_to_release()) {
-                    notify_complete();
-                }
+                complete_result(proto_ptr, std::move(r));
             }
         );
     });
@@ -168,6 +231,142 @@ bool ScanSession::start_one_probe(
     return true;
 }
 
+void ScanSession::complete_result(const IProtocol* proto, ProtocolResult&& r) {
+    if (enrich_stage_) {
+        enrich_stage_->post(this, proto, std::move(r));
+    } else {
+        finish_result(proto, std::move(r));
+    }
+}
+
+void ScanSession::finish_result(const IProtocol* proto, ProtocolResult&& r) {
+    // IO 线程只拷贝了证书 DER 与需要的原始应答，哈希、解析与特征搜索都在这里完成
+    if (!r.attrs.tls.cert_der.empty()) {
+        tls_inspect_certificate(r.attrs);
+    }
+    if (proto && !r.raw.empty()) {
+        proto->enrich(r);
+        r.raw.clear();
+    }
+    push_result(std::move(r));
+    // 计数必须是对 this 的最后一次访问：计数到齐后扫描线程随时可能释放 Session
+    mark_task_completed();
+}
+
+void ScanSession::begin_port_sweep(PortScanner& scanner) {
+    if (target_.ip.empty() || available_ports_.empty() || tasks_total() == 0) {
+        return;
+    }
+    sweep_state_.store(SweepState::Running, std::memory_order_relaxed);
+
+    // 金丝雀：按 IP 散列取两个高位端口一起预扫，正常主机上几乎不会开放
+    std::vector<Port> ports = available_ports_;
+    if (tarpit_detection_) {
+        std::size_t h = std::hash<std::string>{}(target_.ip);
+        for (std::size_t i = 0; canary_ports_.size() < kTarpitCanaries && i < 8; ++i, h = h * 31 + 7) {
+            auto c = static_cast<Port>(40000 + h % 20000);
+            if (std::find(ports.begin(), ports.end(), c) != ports.end()) continue;
+            canary_ports_.push_back(c);
+            ports.push_back(c);
+        }
+    }
+
+    scanner.async_sweep(target_.ip, std::move(ports), [this](std::vector<PortScanResult>&& results) {
+        std::size_t canaries_open = 0;
+        for (const auto& r : results) {
+            if (!r.open) continue;
+            if (std::find(canary_ports_.begin(), canary_ports_.end(), r.port) != canary_ports_.end()) {
+                canaries_open++;
+            } else {
+                open_ports_.push_back(r.port);
+            }
+        }
+        if (!canary_ports_.empty() && canaries_open == canary_ports_.size() &&
+            open_ports_.size() == available_ports_.size()) {
+            flag_tarpit("accepts every port (" + std::to_string(results.size()) + " open, including " +
+                        std::to_string(canary_ports_.size()) + " canary ports)");
+        }
+        // 发布必须是本回调对 this 的最后一次访问
+        sweep_state_.store(SweepState::Done, std::memory_order_release);
+    });
+}
+
+void ScanSession::cancel_pending_probes(const std::vector<std::unique_ptr<IProtocol>>& protocols) {
+    tarpit_cancelled_ = true;
+    std::size_t n = 0;
+    while (!banner_queue_.empty()) {
+        n += banner_queue_.front().protocols.size();
+        banner_queue_.pop();
+    }
+    // UDP 探测不受 TCP 层 tarpit 影响，照常进行
+    for (const auto& p : protocols) {
+        if (!p || p->datagram()) continue;
+        auto it = protocol_port_queues_.find(p->name());
+        if (it == protocol_port_queues_.end()) continue;
+        n += it->second.size();
+        it->second = {};
+    }
+    if (n > 0) {
+        LOG_CORE_INFO("Cancelled {} queued probes for tarpit host {}", n, target_.ip);
+        mark_task_completed(n);
+    }
+}
+
+void ScanSession::start_banner_probe(
+    ThreadPool& scan_pool,
+    const boost::asio::any_io_executor& exec,
+    Timeout timeout
+) {
+    BannerTask task = std::move(banner_queue_.front());
+    banner_queue_.pop();
+
+    // 一次连接覆盖全部候选协议，超时取其中最大者
+    Timeout group_timeout{0};
+    for (const auto* p : task.protocols) {
+        group_timeout = std::max(group_timeout, effective_timeout(*p, timeout));
+    }
+
+    scan_pool.submit([this, task = std::move(task), exec, timeout = group_timeout]() {
+        const std::string& target = target_.domain.empty() ? target_.ip : target_.domain;
+
+        async_banner_probe(
+            task.protocols,
+            target,
+            target_.ip,
+            task.port,
+            timeout,
+            exec,
+            [this, protocols = task.protocols](std::vector<ProtocolResult>&& results) {
+                // 每条结果各计一次数，最后一条交出后不再访问 this
+                for (auto& r : results) {
+                    const IProtocol* proto = nullptr;
+                    for (const auto* p : protocols) {
+                        if (p->name() == r.protocol) {
+                            proto = p;
+                            break;
+                        }
+                    }
+                    complete_result(proto, std::move(r));
+                }
+            }
+        );
+    });
+}
+
+Timeout ScanSession::effective_timeout(const IProtocol& proto, Timeout timeout) const {
+    // 优先考虑动态（当全局为0时），并与协议默认超时取最大值
+    Timeout effective = timeout;
+    if (effective.count() == 0) {
+        effective = LatencyManager::instance().get_timeout(target_.ip);
+    }
+    // 按照约定：每个协议的最终超时 = max(协议默认超时, 全局/动态超时)
+    Timeout proto_default = proto.default_timeout();
+    if (proto_default > effective) {
+        effective = proto_default;
+    }
+    return effective;
+}
+
 bool ScanSession::set_state(State from, State to) {
     State expected = from;
     return state_.compare_exchange_strong(expected, to);
@@ -204,6 +403,7 @@ bool ScanSession::should_probe(const IProtocol& proto, Port port) const {
 void ScanSession::init_protocol_queues(const std::vector<std::unique_ptr<IProtocol>>& protocols) {
     protocol_port_queues_.clear();
     protocol_result_queues_.clear();
+    banner_queue_ = {};
 
     // 为每个协议创建结果队列
     for (const auto& p : protocols) {
@@ -213,13 +413,38 @@ void ScanSession::init_protocol_queues(const std::vector<std::unique_ptr<IProtoc
         protocol_port_queues_[pname] = std::queue<Port>();
     }
 
+    // UDP 协议不经过端口预扫，始终探测默认端口
+    for (const auto& p : protocols) {
+        if (!p || !p->datagram()) continue;
+        auto& q = protocol_port_queues_[p->name()];
+        for (auto d : p->default_ports()) q.push(d);
+    }
+
     if (available_ports_.empty()) {
         return; // 无可用端口，不入队
     }
 
+    // AllAvailable 模式下，同一端口上有多个服务端先发言的协议时合并为一次连接的 Banner 复用任务，
+    // 这些协议不再各自入队该端口。在该端口上需要 TLS 的协议不参与复用（欢迎消息在握手之后），照常单独探测
+    std::unordered_set<Port> banner_ports;
+    if (probe_mode_ == ProbeMode::AllAvailable) {
+        for (auto ap : available_ports_) {
+            BannerTask task{ap, {}};
+            for (const auto& p : protocols) {
+                if (p && p->server_speaks_first() && !p->requires_tls(ap)) {
+                    task.protocols.push_back(p.get());
+                }
+            }
+            if (task.protocols.size() > 1) {
+                banner_ports.insert(ap);
+                banner_queue_.push(std::move(task));
+            }
+        }
+    }
+
     // 依据策略填充每协议的端口队列
     for (const auto& p : protocols) {
-        if (!p) continue;
+        if (!p || p->datagram()) continue;
         const std::string pname = p->name();
         auto& q = protocol_port_queues_[pname];
 
@@ -232,6 +457,7 @@ void ScanSession::init_protocol_queues(const std::vector<std::unique_ptr<IProtoc
             }
         } else { // AllAvailable
             for (auto ap : available_ports_) {
+                if (p->server_speaks_first() && !p->requires_tls(ap) && banner_ports.count(ap)) continue;
                 q.push(ap);
             }
         }
@@ -260,9 +486,72 @@ std::shared_ptr<TaskQueue<ProtocolResult>> ScanSession::result_queue(const std::
     return nullptr;
 }
 
+namespace {
+
+constexpr std::string_view kSilent = "(silent)";
+
+// 应答指纹：有 banner 时取 banner；欢迎消息无效时取错误中附带的原文；探测超时或催促后仍无数据归为同一指纹。
+// 其余错误（连接失败、对 nudge 的应答等）不能说明对端在冒充服务，返回空
+std::string_view reply_signature(const ProtocolResult& r) {
+    if (!r.attrs.banner.empty()) return r.attrs.banner;
+    std::string_view err = r.error;
+    if (err.ends_with("timed out") || err.starts_with("No data within")) return kSilent;
+    auto colon = err.find(": ");
+    if (colon == std::string_view::npos) return {};
+    std::string_view head = err.substr(0, colon);
+    if (head.find("greeting") == std::string_view::npos && head.find("welcome") == std::string_view::npos) {
+        return {};
+    }
+    return err.substr(colon + 2);
+}
+
+} // namespace
+
+void ScanSession::note_reply(const ProtocolResult& r) {
+    // banner 是端口上的服务自己说的，哪个协议解析出来都算；错误只看协议在自己默认端口上的结果，
+    // 跨协议探测（如 HTTP 探 25 端口）超时或报欢迎消息无效是正常现象
+    const bool own_reply = !r.attrs.banner.empty();
+    auto it = std::find_if(port_owners_.begin(), port_owners_.end(), [&](const PortOwner& o) {
+        return o.port == r.port && (own_reply || o.protocol == r.protocol);
+    });
+    if (it == port_owners_.end()) return;
+    std::string_view sig = reply_signature(r);
+
+    int seen = 0;
+    {
+        std::lock_guard<std::mutex> lock(tarpit_mutex_);
+        if (tarpit_.load(std::memory_order_relaxed)) return;
+        if (r.accessible) answered_ = true;
+        // 全部超时的指纹只在该主机还没有成功结果时计入：正常主机上个别服务超时不算
+        if (sig.empty() || (sig == kSilent && answered_)) return;
+        uint32_t& families = reply_families_[std::string(sig)];
+        families |= 1u << it->family;
+        seen = std::popcount(families);
+    }
+    if (seen >= kTarpitFamilies) {
+        flag_tarpit("same reply on " + std::to_string(seen) + " unrelated services: " +
+                    std::string(sig.substr(0, 64)));
+    }
+}
+
+void ScanSession::flag_tarpit(std::string reason) {
+    std::lock_guard<std::mutex> lock(tarpit_mutex_);
+    if (tarpit_.load(std::memory_order_relaxed)) return;
+    tarpit_reason_ = std::move(reason);
+    tarpit_.store(true, std::memory_order_release);
+    LOG_CORE_WARN("Host {} classified as tarpit: {}", target_.ip, tarpit_reason_);
+}
+
+std::string ScanSession::tarpit_reason() const {
+    std::lock_guard<std::mutex> lock(tarpit_mutex_);
+    return tarpit_reason_;
+}
+
 void ScanSession::push_result(ProtocolResult&& r) {
-    mark_task_completed();
-    
+    if (tarpit_detection_) {
+        note_reply(r);
+    }
+
     // 动态超时统计：如果有响应且成功
     if (r.accessible && r.attrs.response_time_ms > 0) {
         LatencyManager::instance().update(
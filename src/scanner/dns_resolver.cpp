@@ -472,6 +472,10 @@ bool CAresResolver::query_a_record(
     }, ctx_ptr);
 
     bool loop_ok = run_event_loop(timeout, done);
+    if (!loop_ok) {
+        // 超时后取消未完成的查询：回调持有栈上 done 的指针，必须在返回前触发
+        ares_cancel(channel_);
+    }
     // c-ares doesn't set 'done' automatically; check sockets until none
     done.store(true);
 
@@ -549,6 +553,9 @@ bool CAresResolver::query_mx_records(
     #pragma clang diagnostic pop
 
     bool loop_ok = run_event_loop(timeout, done);
+    if (!loop_ok) {
+        ares_cancel(channel_);
+    }
     done.store(true);
 
     if (!loop_ok) {
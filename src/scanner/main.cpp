@@ -152,6 +152,14 @@ ScannerConfig load_config(const string& config_file) {
                 if (s.contains("only_success")) config.only_success = s["only_success"];
                 if (s.contains("max_work_count")) config.max_work_count = s["max_work_count"];
                 if (s.contains("targets_max_size")) config.targets_max_size = s["targets_max_size"];
+                if (s.contains("optimistic_commands")) config.optimistic_commands = s["optimistic_commands"];
+                if (s.contains("idle_nudge_ms")) config.idle_nudge = std::chrono::milliseconds(s["idle_nudge_ms"]);
+                if (s.contains("idle_nudge")) config.idle_nudge_payload = s["idle_nudge"];
+                if (s.contains("min_recv_rate")) config.min_recv_rate = s["min_recv_rate"];
+                if (s.contains("recv_rate_window_ms")) {
+                    config.recv_rate_window = std::chrono::milliseconds(s["recv_rate_window_ms"]);
+                }
+                if (s.contains("tarpit_detection")) config.tarpit_detection = s["tarpit_detection"];
             }
 
             // ===== Protocols 配置 =====
@@ -161,6 +169,12 @@ ScannerConfig load_config(const string& config_file) {
                 if (p.contains("POP3") && p["POP3"].contains("enabled")) config.enable_pop3 = p["POP3"]["enabled"];
                 if (p.contains("IMAP") && p["IMAP"].contains("enabled")) config.enable_imap = p["IMAP"]["enabled"];
                 if (p.contains("HTTP") && p["HTTP"].contains("enabled")) config.enable_http = p["HTTP"]["enabled"];
+                if (p.contains("HTTP") && p["HTTP"].contains("vhost_connections")) {
+                    config.http_vhost_connections = p["HTTP"]["vhost_connections"];
+                }
+                if (p.contains("HTTP") && p["HTTP"].contains("requests")) {
+                    config.http_requests = p["HTTP"]["requests"].get<std::vector<std::string>>();
+                }
                 if (p.contains("FTP") && p["FTP"].contains("enabled")) config.enable_ftp = p["FTP"]["enabled"];
                 if (p.contains("TELNET") && p["TELNET"].contains("enabled")) config.enable_telnet = p["TELNET"]["enabled"];
                 if (p.contains("SSH") && p["SSH"].contains("enabled")) config.enable_ssh = p["SSH"]["enabled"];
@@ -172,6 +186,48 @@ ScannerConfig load_config(const string& config_file) {
                 if (d.contains("resolver_type")) config.dns_resolver_type = d["resolver_type"];
                 if (d.contains("max_mx_records")) config.dns_max_mx_records = d["max_mx_records"];
                 if (d.contains("timeout_ms")) config.dns_config_timeout = std::chrono::milliseconds(d["timeout_ms"]);
+                if (d.contains("prefetch_workers")) config.dns_prefetch_workers = d["prefetch_workers"];
+                if (d.contains("lookahead_min")) config.dns_lookahead_min = d["lookahead_min"];
+                if (d.contains("lookahead_max")) config.dns_lookahead_max = d["lookahead_max"];
+            }
+
+            // ===== 端口预扫配置 =====
+            if (j.contains("port_prepass")) {
+                auto pp = j["port_prepass"];
+                if (pp.contains("enabled")) config.port_prepass = pp["enabled"];
+                if (pp.contains("timeout_ms")) config.port_prepass_timeout = std::chrono::milliseconds(pp["timeout_ms"]);
+                if (pp.contains("max_inflight")) config.port_prepass_max_inflight = pp["max_inflight"];
+                if (pp.contains("rate_per_sec")) config.port_prepass_rate = pp["rate_per_sec"];
+                if (pp.contains("syn_scan")) config.port_prepass_syn = pp["syn_scan"];
+                if (pp.contains("syn_retries")) config.port_prepass_syn_retries = pp["syn_retries"];
+            }
+
+            // ===== 脚本探测 =====
+            if (j.contains("scripted_probes")) {
+                auto sp = j["scripted_probes"];
+                if (sp.contains("file")) config.probe_definition_file = sp["file"];
+            }
+
+            // ===== 服务识别 =====
+            if (j.contains("service_detection")) {
+                auto sd = j["service_detection"];
+                if (sd.contains("enabled")) config.enable_service = sd["enabled"];
+                if (sd.contains("probe_file")) config.service_probe_file = sd["probe_file"];
+                if (sd.contains("ports")) config.service_ports = sd["ports"].get<std::vector<Port>>();
+                if (sd.contains("intensity")) config.service_intensity = sd["intensity"];
+                if (sd.contains("max_probes")) config.service_max_probes = sd["max_probes"];
+            }
+
+            // ===== UDP 探测 =====
+            if (j.contains("udp")) {
+                auto u = j["udp"];
+                if (u.contains("protocols")) config.udp_protocols = u["protocols"].get<std::vector<std::string>>();
+            }
+
+            // ===== TLS 配置 =====
+            if (j.contains("tls")) {
+                auto t = j["tls"];
+                if (t.contains("starttls")) config.starttls = t["starttls"];
             }
 
             // ===== Output 配置 =====
@@ -291,7 +347,12 @@ int main(int argc, char* argv[]) {
             ("cpu-threads", po::value<int>(), "CPU thread pool size (protocol processing)")
             ("config,c", po::value<string>(), "Configuration file")
             ("protocols,p", po::value<string>(),
-             "Comma-separated list of protocols (SMTP,POP3,IMAP,HTTP,FTP,TELNET,SSH)")
+             "Comma-separated list of protocols (SMTP,POP3,IMAP,HTTP,FTP,TELNET,SSH,SERVICE, UDP: DNS,NTP,NTP_PRIVATE,SNMP,SSDP, or names from the probe file)")
+            ("probe-file", po::value<string>(),
+             "Scripted probe definitions (default: ./config/probes.json)")
+            ("service-detection", "Identify services and versions with nmap-service-probes style probes")
+            ("service-probe-file", po::value<string>(),
+             "Service probe database (default: ./config/service-probes)")
             ("format,f", po::value<string>()->default_value("text"),
              "Output format (text,json,csv,report)")
             ("only-success", "Only output successful probes (hide failures)")
@@ -299,11 +360,23 @@ int main(int argc, char* argv[]) {
             ("no-pop3", "Disable POP3 scanning")
             ("no-imap", "Disable IMAP scanning")
             ("enable-http", "Enable HTTP scanning")
+            ("http-requests", po::value<string>(),
+             "HTTP requests pipelined on one connection, comma-separated (e.g. \"HEAD /,GET /robots.txt\")")
             ("enable-ftp", "Enable FTP scanning")
             ("enable-telnet", "Enable Telnet scanning")
             ("no-ftp", "Disable FTP scanning")
             ("enable-ssh", "Enable SSH scanning")
             ("scan-all-ports", "Scan all available ports instead of protocol defaults")
+            ("min-recv-rate", po::value<int>(),
+             "Give up on connections that drip data below this many bytes/s (0 = off)")
+            ("idle-nudge", po::value<int>(),
+             "Idle ms before nudging a silent non-default port, then closing it after as long again (0 = wait for timeout)")
+            ("no-tarpit-detection", "Keep probing hosts that accept every port or repeat one reply everywhere")
+            ("no-port-prepass", "Probe every port directly, without the connect-only liveness pre-pass")
+            ("syn-scan", "Discover open ports with raw-socket SYN probes (needs CAP_NET_RAW)")
+            ("starttls", "Upgrade SMTP/IMAP/POP3 to TLS via STARTTLS/STLS when advertised")
+            ("optimistic-commands",
+             "Send EHLO/CAPA/CAPABILITY/FEAT+SYST right after connect, without waiting for the greeting")
             ("vendor-file", po::value<string>(),
              "Vendor pattern file (default: ./config/vendors.json)")
             ("verbose", "Enable verbose output")
@@ -458,6 +531,7 @@ int main(int argc, char* argv[]) {
             config.enable_http = false;
             config.enable_telnet = false;
             config.enable_ssh = false;
+            config.enable_service = false;
             for (auto& p : config.custom_protocols) {
                 if (p == "SMTP") config.enable_smtp = true;
                 else if (p == "POP3") config.enable_pop3 = true;
@@ -465,11 +539,49 @@ int main(int argc, char* argv[]) {
                 else if (p == "HTTP") config.enable_http = true;
                 else if (p == "TELNET") config.enable_telnet = true;
                 else if (p == "SSH") config.enable_ssh = true;
+                else if (p == "SERVICE") config.enable_service = true;
             }
         }
         if (vm.count("scan-all-ports")) {
             config.scan_all_ports = true;
         }
+        if (vm.count("no-port-prepass")) {
+            config.port_prepass = false;
+        }
+        if (vm.count("syn-scan")) {
+            config.port_prepass_syn = true;
+        }
+        if (vm.count("probe-file")) {
+            config.probe_definition_file = vm["probe-file"].as<string>();
+        }
+        if (vm.count("service-detection")) {
+            config.enable_service = true;
+        }
+        if (vm.count("service-probe-file")) {
+            config.service_probe_file = vm["service-probe-file"].as<string>();
+        }
+        if (vm.count("starttls")) {
+            config.starttls = true;
+        }
+        if (vm.count("optimistic-commands")) {
+            config.optimistic_commands = true;
+        }
+        if (vm.count("no-tarpit-detection")) {
+            config.tarpit_detection = false;
+        }
+        if (vm.count("min-recv-rate")) {
+            config.min_recv_rate = static_cast<size_t>(std::max(0, vm["min-recv-rate"].as<int>()));
+        }
+        if (vm.count("idle-nudge")) {
+            config.idle_nudge = std::chrono::milliseconds(std::max(0, vm["idle-nudge"].as<int>()));
+        }
+        if (vm.count("http-requests")) {
+            config.http_requests.clear();
+            std::istringstream list(vm["http-requests"].as<string>());
+            for (string item; std::getline(list, item, ',');) {
+                if (!item.empty()) config.http_requests.push_back(item);
+            }
+        }
 
         // 覆盖输出目录与格式
         if (vm.count("output")) {
@@ -624,6 +736,15 @@ int main(int argc, char* argv[]) {
                         oss << "  " << protocol << ": " << count << "\n";
                     }
                     oss << "\nTotal Time: " << stats.total_time.count() << " ms\n";
+                    oss << "DNS Prefetch: hits=" << stats.dns_prefetch_hits
+                        << " misses=" << stats.dns_prefetch_misses
+                        << " window=" << stats.dns_lookahead_window
+                        << " avg_latency=" << stats.dns_avg_latency_ms << " ms\n";
+                    oss << "Port Pre-pass: attempts=" << stats.port_attempts
+                        << " open=" << stats.port_open
+                        << " refused=" << stats.port_refused
+                        << " filtered=" << stats.port_filtered
+                        << " syn_sent=" << stats.port_syn_sent << "\n";
                     oss << "====================================================\n";
                 }
 
@@ -1,4 +1,5 @@
 #include "scanner/output/result_handler.h"
+#include "scanner/protocols/cert_cache.h"
 #include <nlohmann/json.hpp>
 #include <iostream>
 #include <unordered_map>
@@ -9,6 +10,30 @@ namespace scanner {
 
 static inline const char* bool_str(bool v) { return v ? "1" : "0"; }
 
+template <std::size_t N>
+static std::string hex_str(const std::array<uint8_t, N>& bytes) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string out(N * 2, '\0');
+    for (std::size_t i = 0; i < N; ++i) {
+        out[2 * i] = kHex[bytes[i] >> 4];
+        out[2 * i + 1] = kHex[bytes[i] & 0x0f];
+    }
+    return out;
+}
+
+// 服务识别结果的单行表示，与 nmap VERSION 列相近："ssh OpenSSH 9.6p1 (protocol 2.0) os=Linux"
+static std::string service_str(const decltype(ProtocolAttributes::service)& svc) {
+    std::string out = svc.name;
+    if (!svc.product.empty()) out += " " + svc.product;
+    if (!svc.version.empty()) out += " " + svc.version;
+    if (!svc.info.empty()) out += " (" + svc.info + ")";
+    if (!svc.hostname.empty()) out += " host=" + svc.hostname;
+    if (!svc.os.empty()) out += " os=" + svc.os;
+    if (!svc.device.empty()) out += " device=" + svc.device;
+    if (svc.soft) out += " [soft]";
+    return out;
+}
+
 // -------------- 文本格式 --------------
 
 std::string ResultHandler::to_text(const ScanReport& report) const {
@@ -23,10 +48,13 @@ std::string ResultHandler::to_text(const ScanReport& report) const {
         filtered_protocols.push_back(pr);
     }
 
-    // 仅当有过滤后的协议结果时才输出目标行
-    if (!filtered_protocols.empty()) {
+    // 仅当有过滤后的协议结果或 tarpit 标记时才输出目标行
+    if (!filtered_protocols.empty() || !report.tarpit.empty()) {
         oss << report.target.domain << " (" << report.target.ip << ")\n";
     }
+    if (!report.tarpit.empty()) {
+        oss << "  tarpit: " << report.tarpit << "\n";
+    }
 
     for (const auto& pr : filtered_protocols) {
         oss << "  [" << pr.protocol << "] " << pr.host << ":" << pr.port
@@ -36,6 +64,15 @@ std::string ResultHandler::to_text(const ScanReport& report) const {
         if (pr.accessible) {
             if (!pr.attrs.banner.empty()) oss << "    banner: " << pr.attrs.banner << "\n";
             if (!pr.attrs.vendor.empty()) oss << "    vendor: " << pr.attrs.vendor << "\n";
+            if (pr.attrs.tls.enabled) {
+                oss << "    tls: " << pr.attrs.tls.version << ' ' << pr.attrs.tls.cipher
+                    << (pr.attrs.tls.resumed ? " (resumed)" : "")
+                    << (pr.attrs.tls.starttls ? " (starttls)" : "") << "\n";
+                // 证书详情见 certificates.txt，这里只给 ID 与指纹
+                if (const auto* cert = CertificateCache::instance().find(pr.attrs.tls.cert_id)) {
+                    oss << "    cert: #" << cert->id << " sha256: " << cert->sha256 << "\n";
+                }
+            }
             if (pr.protocol == "SMTP") {
                 oss << "    features: PIPELINING=" << bool_str(pr.attrs.smtp.pipelining)
                     << ", STARTTLS=" << bool_str(pr.attrs.smtp.starttls)
@@ -47,6 +84,25 @@ std::string ResultHandler::to_text(const ScanReport& report) const {
                     << ", AUTH=" << (pr.attrs.smtp.auth_methods.empty() ? std::string("-") : pr.attrs.smtp.auth_methods)
                     << "\n";
             }
+            if (!pr.attrs.fields.empty()) {
+                oss << "    fields: ";
+                for (std::size_t i = 0; i < pr.attrs.fields.size(); ++i) {
+                    oss << (i ? ", " : "") << pr.attrs.fields[i].first << '=' << pr.attrs.fields[i].second;
+                }
+                oss << "\n";
+            }
+            if (!pr.attrs.service.name.empty()) {
+                oss << "    service: " << service_str(pr.attrs.service) << "\n";
+                for (const auto& cpe : pr.attrs.service.cpe) oss << "    cpe: " << cpe << "\n";
+            }
+            if (pr.attrs.ssh.kexinit) {
+                oss << "    hassh: " << hex_str(pr.attrs.ssh.hassh) << "\n"
+                    << "    kex: " << pr.attrs.ssh.kex << "\n"
+                    << "    hostkey: " << pr.attrs.ssh.host_key << "\n"
+                    << "    ciphers: " << pr.attrs.ssh.ciphers << "\n"
+                    << "    macs: " << pr.attrs.ssh.macs << "\n"
+                    << "    compression: " << pr.attrs.ssh.compression << "\n";
+            }
         }
     }
     return oss.str();
@@ -156,6 +212,7 @@ std::string ResultHandler::to_json(const ScanReport& report) const {
     j["domain"] = report.target.domain;
     j["ip"] = report.target.ip;
     j["total_time_ms"] = report.total_time.count();
+    if (!report.tarpit.empty()) j["tarpit"] = report.tarpit;
     j["protocols"] = nlohmann::json::array();
     for (const auto& pr : report.protocols) {
         if (only_success_ && !pr.accessible) continue;
@@ -166,6 +223,7 @@ std::string ResultHandler::to_json(const ScanReport& report) const {
         jp["port"] = pr.port;
         jp["accessible"] = pr.accessible;
         jp["error"] = pr.error;
+        if (pr.budget != BudgetTrip::None) jp["budget"] = to_string(pr.budget);
         jp["banner"] = pr.attrs.banner;
         jp["vendor"] = pr.attrs.vendor;
         jp["response_time_ms"] = pr.attrs.response_time_ms;
@@ -217,6 +275,49 @@ std::string ResultHandler::to_json(const ScanReport& report) const {
             a["status_code"] = pr.attrs.http.status_code;
             jp["http"] = a;
         }
+        // 脚本探测字段
+        if (!pr.attrs.fields.empty()) {
+            nlohmann::json a;
+            for (const auto& [key, value] : pr.attrs.fields) a[key] = value;
+            jp["fields"] = a;
+        }
+        // 服务识别
+        if (!pr.attrs.service.name.empty()) {
+            const auto& svc = pr.attrs.service;
+            nlohmann::json a;
+            a["name"] = svc.name;
+            a["probe"] = svc.probe;
+            a["soft"] = svc.soft;
+            if (!svc.product.empty()) a["product"] = svc.product;
+            if (!svc.version.empty()) a["version"] = svc.version;
+            if (!svc.info.empty()) a["info"] = svc.info;
+            if (!svc.hostname.empty()) a["hostname"] = svc.hostname;
+            if (!svc.os.empty()) a["os"] = svc.os;
+            if (!svc.device.empty()) a["device"] = svc.device;
+            if (!svc.cpe.empty()) a["cpe"] = svc.cpe;
+            jp["service"] = a;
+        }
+        // SSH
+        if (pr.attrs.ssh.kexinit) {
+            nlohmann::json a;
+            a["hassh"] = hex_str(pr.attrs.ssh.hassh);
+            a["kex"] = pr.attrs.ssh.kex;
+            a["host_key"] = pr.attrs.ssh.host_key;
+            a["ciphers"] = pr.attrs.ssh.ciphers;
+            a["macs"] = pr.attrs.ssh.macs;
+            a["compression"] = pr.attrs.ssh.compression;
+            jp["ssh"] = a;
+        }
+        // TLS
+        if (pr.attrs.tls.enabled) {
+            nlohmann::json a;
+            a["version"] = pr.attrs.tls.version;
+            a["cipher"] = pr.attrs.tls.cipher;
+            a["resumed"] = pr.attrs.tls.resumed;
+            a["starttls"] = pr.attrs.tls.starttls;
+            a["cert_id"] = pr.attrs.tls.cert_id;
+            jp["tls"] = a;
+        }
         j["protocols"].push_back(jp);
     }
     return j.dump(2);
@@ -319,6 +420,27 @@ std::string ResultHandler::format_attributes(const ProtocolAttributes& attrs) co
             << "type=" << attrs.http.content_type << ','
             << "code=" << attrs.http.status_code << "};";
     }
+    if (!attrs.fields.empty()) {
+        oss << "fields{";
+        for (std::size_t i = 0; i < attrs.fields.size(); ++i) {
+            oss << (i ? "," : "") << attrs.fields[i].first << '=' << attrs.fields[i].second;
+        }
+        oss << "};";
+    }
+    if (!attrs.service.name.empty()) {
+        oss << "service{" << service_str(attrs.service) << "};";
+    }
+    if (attrs.ssh.kexinit) {
+        oss << "ssh{hassh=" << hex_str(attrs.ssh.hassh) << "};";
+    }
+    if (attrs.tls.enabled) {
+        oss << "tls{"
+            << "version=" << attrs.tls.version << ','
+            << "cipher=" << attrs.tls.cipher << ','
+            << "resumed=" << (attrs.tls.resumed?"1":"0") << ','
+            << "starttls=" << (attrs.tls.starttls?"1":"0") << ','
+            << "cert=" << attrs.tls.cert_id << "};";
+    }
     return oss.str();
 }
 
@@ -0,0 +1,406 @@
+#include "scanner/network/port_scanner.h"
+#include "scanner/common/io_thread_pool.h"
+#include "scanner/common/probe_pool.h"
+#include "scanner/network/syn_scanner.h"
+#include "scanner/common/logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace scanner {
+
+namespace {
+
+std::vector<PortScanResult> closed_results(const std::vector<Port>& ports) {
+    std::vector<PortScanResult> results;
+    results.reserve(ports.size());
+    for (auto p : ports) {
+        results.push_back(PortScanResult{p, false, {}, 0.0});
+    }
+    return results;
+}
+
+} // namespace
+
+// =====================
+// 单主机扫描上下文
+// =====================
+// 全部状态只在所属 io_context 的线程上访问；连接处理器与期限定时器共同持有上下文。
+// 连接模式每个端口一个 socket；SYN 模式不建 socket，由 PortScanner 按目标地址把应答分发进来。
+
+struct PortScanner::Sweep : std::enable_shared_from_this<Sweep> {
+    Sweep(asio::io_context& ctx, std::shared_ptr<PortScanner> owner,
+          std::vector<Port> ports, SweepCallback on_done, bool syn)
+        : deadline(ctx),
+          owner(std::move(owner)),
+          ports(std::move(ports)),
+          on_done(std::move(on_done)),
+          syn(syn) {
+        if (!syn) {
+            sockets.reserve(this->ports.size());
+            for (std::size_t i = 0; i < this->ports.size(); ++i) {
+                sockets.emplace_back(ctx);
+            }
+        }
+        rtt_ms.assign(this->ports.size(), -1.0f);
+    }
+
+    void start(const asio::ip::address& address, std::chrono::milliseconds timeout) {
+        started = std::chrono::steady_clock::now();
+        pending = ports.size();
+
+        // 期限到达时关闭仍在连接中的 socket，未完成的尝试以 operation_aborted 结束
+        deadline.expires_after(timeout);
+        deadline.async_wait(pooled([self = shared_from_this()](const boost::system::error_code& ec) {
+            if (ec) return;
+            for (auto& s : self->sockets) {
+                boost::system::error_code ignored;
+                s.close(ignored);
+            }
+        }));
+
+        for (std::size_t i = 0; i < ports.size(); ++i) {
+            sockets[i].async_connect(tcp::endpoint(address, ports[i]), pooled(
+                [self = shared_from_this(), i](const boost::system::error_code& ec) {
+                    self->on_connect(i, ec);
+                }));
+        }
+    }
+
+    void on_connect(std::size_t i, const boost::system::error_code& ec) {
+        if (!ec) {
+            mark_open(i);
+        } else if (ec == asio::error::connection_refused) {
+            owner->refused_.fetch_add(1, std::memory_order_relaxed);
+        } else if (ec == asio::error::operation_aborted) {
+            owner->filtered_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            owner->errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+        owner->attempts_.fetch_add(1, std::memory_order_relaxed);
+
+        // 只探测存活，连接建立即关闭，尽早释放文件描述符
+        boost::system::error_code ignored;
+        sockets[i].close(ignored);
+
+        if (--pending == 0) {
+            finish();
+        }
+    }
+
+    // SYN 模式：期限按重发次数均分，每一段结束时向仍未应答的端口重发
+    void start_syn(const asio::ip::address_v4& src, const asio::ip::address_v4& dst,
+                   std::chrono::milliseconds timeout, std::size_t retries) {
+        started = std::chrono::steady_clock::now();
+        pending = ports.size();
+        syn_src = src;
+        syn_dst = dst;
+        answered.assign(ports.size(), false);
+        syn_rounds_left = retries;
+        syn_slice = timeout / static_cast<int>(retries + 1);
+
+        owner->syn_sweeps_.emplace(dst.to_uint(), this);
+        send_unanswered();
+        arm_syn_slice();
+    }
+
+    void send_unanswered() {
+        for (std::size_t i = 0; i < ports.size(); ++i) {
+            if (answered[i]) continue;
+            if (!owner->syn_->send_syn(syn_src, syn_dst, ports[i])) {
+                LOG_NETWORK_DEBUG("SYN to {}:{} not sent: {}", syn_dst.to_string(), ports[i],
+                                  std::strerror(errno));
+            }
+        }
+    }
+
+    void arm_syn_slice() {
+        deadline.expires_after(syn_slice);
+        deadline.async_wait(pooled([self = shared_from_this()](const boost::system::error_code& ec) {
+            if (ec || self->done) return;
+            if (self->syn_rounds_left > 0) {
+                --self->syn_rounds_left;
+                self->send_unanswered();
+                self->arm_syn_slice();
+                return;
+            }
+            // 期限内无应答的端口记为被过滤
+            self->owner->filtered_.fetch_add(self->pending, std::memory_order_relaxed);
+            self->owner->attempts_.fetch_add(self->pending, std::memory_order_relaxed);
+            self->pending = 0;
+            self->finish();
+        }));
+    }
+
+    void on_syn_reply(Port port, bool open) {
+        if (done) return;
+        for (std::size_t i = 0; i < ports.size(); ++i) {
+            if (ports[i] != port || answered[i]) continue;
+            answered[i] = true;
+            if (open) {
+                mark_open(i);
+            } else {
+                owner->refused_.fetch_add(1, std::memory_order_relaxed);
+            }
+            owner->attempts_.fetch_add(1, std::memory_order_relaxed);
+            if (--pending == 0) {
+                finish();
+            }
+            return;
+        }
+    }
+
+    void mark_open(std::size_t i) {
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        rtt_ms[i] = std::chrono::duration<float, std::milli>(elapsed).count();
+        owner->open_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void finish() {
+        done = true;
+        (void)deadline.cancel();
+        if (syn) {
+            auto range = owner->syn_sweeps_.equal_range(syn_dst.to_uint());
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == this) {
+                    owner->syn_sweeps_.erase(it);
+                    break;
+                }
+            }
+        }
+        std::vector<PortScanResult> results;
+        results.reserve(ports.size());
+        for (std::size_t i = 0; i < ports.size(); ++i) {
+            bool open = rtt_ms[i] >= 0.0f;
+            results.push_back(PortScanResult{ports[i], open, {}, open ? rtt_ms[i] : 0.0});
+        }
+        owner->on_sweep_done(ports.size());
+        on_done(std::move(results));
+    }
+
+    steady_timer deadline;
+    std::shared_ptr<PortScanner> owner;
+    std::vector<Port> ports;
+    std::vector<tcp::socket> sockets;
+    std::vector<float> rtt_ms;  // 连接耗时，小于 0 表示未开放
+    std::size_t pending = 0;
+    std::chrono::steady_clock::time_point started;
+    SweepCallback on_done;
+    bool done = false;
+
+    // SYN 模式状态
+    bool syn = false;
+    asio::ip::address_v4 syn_src;
+    asio::ip::address_v4 syn_dst;
+    std::vector<bool> answered;
+    std::size_t syn_rounds_left = 0;
+    std::chrono::milliseconds syn_slice{0};
+};
+
+// =====================
+// 端口扫描器
+// =====================
+
+PortScanner::PortScanner(IoThreadPool& io, PortScannerConfig config)
+    : io_(io),
+      config_(config),
+      tokens_(static_cast<double>(config.rate_per_sec)),
+      last_refill_(std::chrono::steady_clock::now()) {
+    if (config_.max_inflight == 0) config_.max_inflight = 1;
+    if (config_.syn_scan) {
+        // 应答接收与全部 SYN 扫描上下文固定在同一 IO 线程上
+        syn_ctx_ = &io_.next_context();
+        syn_ = SynScanner::create(*syn_ctx_, [this](std::uint32_t dst, Port port, bool open) {
+            on_syn_reply(dst, port, open);
+        });
+        if (syn_) {
+            syn_->start();
+            LOG_NETWORK_INFO("Port pre-pass using raw SYN scan");
+        }
+    }
+}
+
+PortScanner::~PortScanner() = default;
+
+void PortScanner::async_sweep(const std::string& host, std::vector<Port> ports, SweepCallback on_done) {
+    submit(PendingSweep{host, std::move(ports), config_.connect_timeout, std::move(on_done)});
+}
+
+PortScanResult PortScanner::scan(const std::string& host, Port port, std::chrono::milliseconds timeout) {
+    return async_scan(host, port, timeout).get();
+}
+
+std::vector<PortScanResult> PortScanner::scan(
+    const std::string& host,
+    const std::vector<Port>& ports,
+    std::chrono::milliseconds timeout
+) {
+    auto promise = std::make_shared<std::promise<std::vector<PortScanResult>>>();
+    auto future = promise->get_future();
+    submit(PendingSweep{host, ports, timeout, [promise](std::vector<PortScanResult>&& results) {
+        promise->set_value(std::move(results));
+    }});
+    return future.get();
+}
+
+std::future<PortScanResult> PortScanner::async_scan(
+    const std::string& host,
+    Port port,
+    std::chrono::milliseconds timeout
+) {
+    auto promise = std::make_shared<std::promise<PortScanResult>>();
+    auto future = promise->get_future();
+    submit(PendingSweep{host, {port}, timeout, [promise](std::vector<PortScanResult>&& results) {
+        promise->set_value(std::move(results.front()));
+    }});
+    return future;
+}
+
+void PortScanner::shutdown() {
+    std::deque<PendingSweep> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+        dropped.swap(queue_);
+    }
+    if (syn_) {
+        // 原始套接字只在接收线程上关闭，避免与进行中的等待竞争
+        asio::post(*syn_ctx_, [self = shared_from_this()]() { self->syn_->stop(); });
+    }
+    // 排队中的主机不再发起连接，直接按全部关闭回调，保证每次提交恰好回调一次
+    for (auto& p : dropped) {
+        p.on_done(closed_results(p.ports));
+    }
+}
+
+PortScannerStats PortScanner::stats() const {
+    PortScannerStats s;
+    s.attempts = attempts_.load(std::memory_order_relaxed);
+    s.open = open_.load(std::memory_order_relaxed);
+    s.refused = refused_.load(std::memory_order_relaxed);
+    s.filtered = filtered_.load(std::memory_order_relaxed);
+    s.errors = errors_.load(std::memory_order_relaxed);
+    s.syn_sent = syn_ ? syn_->sent() : 0;
+    return s;
+}
+
+void PortScanner::submit(PendingSweep&& pending) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopped_) {
+            queue_.push_back(std::move(pending));
+            pending.on_done = nullptr;
+        }
+    }
+    if (pending.on_done) {
+        pending.on_done(closed_results(pending.ports));
+        return;
+    }
+    pump();
+}
+
+void PortScanner::pump() {
+    std::vector<PendingSweep> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) return;
+
+        // 令牌桶：每秒补充 rate_per_sec 个，最多攒一秒的量；允许单个主机透支
+        const double rate = static_cast<double>(config_.rate_per_sec);
+        if (rate > 0) {
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+            tokens_ = std::min(rate, tokens_ + elapsed * rate);
+            last_refill_ = now;
+        }
+
+        while (!queue_.empty()) {
+            std::size_t n = queue_.front().ports.size();
+            // 单个主机的端口数超过上限时，等到没有其他尝试在进行再放行
+            if (inflight_ > 0 && inflight_ + n > config_.max_inflight) break;
+            if (rate > 0 && tokens_ < 1.0) {
+                arm_pacer(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>((1.0 - tokens_) / rate)));
+                break;
+            }
+            tokens_ -= static_cast<double>(n);
+            inflight_ += n;
+            ready.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+    }
+    for (auto& p : ready) {
+        launch(std::move(p));
+    }
+}
+
+void PortScanner::launch(PendingSweep&& pending) {
+    boost::system::error_code ec;
+    auto address = asio::ip::make_address(pending.host, ec);
+    if (ec || pending.ports.empty()) {
+        LOG_NETWORK_DEBUG("Port sweep skipped for '{}': {}", pending.host,
+                          ec ? ec.message() : std::string("no ports"));
+        on_sweep_done(pending.ports.size());
+        pending.on_done(closed_results(pending.ports));
+        return;
+    }
+
+    if (syn_ && address.is_v4()) {
+        asio::ip::address_v4 src;
+        if (SynScanner::source_for(address.to_v4(), src)) {
+            auto sweep = std::allocate_shared<Sweep>(ProbeAllocator<Sweep>(), *syn_ctx_,
+                                                     shared_from_this(), std::move(pending.ports),
+                                                     std::move(pending.on_done), true);
+            asio::post(*syn_ctx_, pooled([sweep, src, dst = address.to_v4(), timeout = pending.timeout,
+                                          retries = config_.syn_retries]() {
+                sweep->start_syn(src, dst, timeout, retries);
+            }));
+            return;
+        }
+        LOG_NETWORK_DEBUG("No route to {}, using connect scan", pending.host);
+    }
+
+    auto sweep = std::allocate_shared<Sweep>(ProbeAllocator<Sweep>(), io_.next_context(),
+                                             shared_from_this(), std::move(pending.ports),
+                                             std::move(pending.on_done), false);
+    // 在所属 IO 线程上发起全部连接，上下文此后只在该线程上访问
+    asio::post(sweep->deadline.get_executor(),
+               pooled([sweep, address, timeout = pending.timeout]() { sweep->start(address, timeout); }));
+}
+
+void PortScanner::on_sweep_done(std::size_t attempts) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inflight_ -= std::min(inflight_, attempts);
+    }
+    pump();
+}
+
+void PortScanner::arm_pacer(std::chrono::steady_clock::duration delay) {
+    if (pacer_armed_) return;
+    pacer_armed_ = true;
+    // 定时器随处理器一起释放，不比所属 io_context 活得更久
+    auto timer = std::make_shared<steady_timer>(io_.next_context(), delay);
+    timer->async_wait([self = shared_from_this(), timer](const boost::system::error_code&) {
+        {
+            std::lock_guard<std::mutex> lock(self->mutex_);
+            self->pacer_armed_ = false;
+        }
+        self->pump();
+    });
+}
+
+void PortScanner::on_syn_reply(std::uint32_t dst, Port port, bool open) {
+    // 同一地址可能有多个扫描在进行（重复目标），先取出再分发，分发中可能有扫描结束并注销
+    auto range = syn_sweeps_.equal_range(dst);
+    if (range.first == range.second) return;
+    std::vector<std::shared_ptr<Sweep>> targets;
+    for (auto it = range.first; it != range.second; ++it) {
+        targets.push_back(it->second->shared_from_this());
+    }
+    for (auto& sweep : targets) {
+        sweep->on_syn_reply(port, open);
+    }
+}
+
+} // namespace scanner
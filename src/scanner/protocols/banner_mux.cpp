@@ -0,0 +1,121 @@
+#include "scanner/protocols/banner_mux.h"
+#include "scanner/protocols/probe_engine.h"
+#include "scanner/common/logger.h"
+#include <algorithm>
+
+namespace scanner {
+
+namespace {
+
+// =====================
+// 候选协议组
+// =====================
+// 复用探测与接手的后续对话二者中只有一个给出结果，由它展开为每个候选的结果。
+
+struct BannerGroup {
+    std::vector<IProtocol*> candidates;
+    std::function<void(std::vector<ProtocolResult>&&)> on_complete;
+
+    // matched 为空表示未进入任何协议的对话，result 的错误由所有候选共享
+    void finish(ProtocolResult&& result, const IProtocol* matched) {
+        std::vector<ProtocolResult> results;
+        results.reserve(candidates.size());
+        for (const auto* p : candidates) {
+            if (p == matched) continue;
+            ProtocolResult r;
+            r.protocol = p->name();
+            r.host = result.host;
+            r.port = result.port;
+            r.error = matched ? "Greeting identified as " + matched->name() : result.error;
+            results.push_back(std::move(r));
+        }
+        if (matched) {
+            results.push_back(std::move(result));
+        }
+        on_complete(std::move(results));
+    }
+};
+
+// =====================
+// 欢迎消息探测步骤
+// =====================
+
+class BannerProbe : public ProbeEngine<BannerProbe> {
+public:
+    BannerProbe(ProbeParams&& params, std::shared_ptr<BannerGroup> group)
+        : ProbeEngine(std::move(params)), group_(std::move(group)) {}
+
+private:
+    friend class ProbeEngine<BannerProbe>;
+
+    // 只窥视首段数据，不消费：接手的协议从自己的第一个读步骤起读到完整欢迎消息
+    ProbeTask run() {
+        auto greeting = co_await peek("greeting");
+        IProtocol* matched = classify(greeting);
+        if (!matched) {
+            finish_error("Unrecognized greeting: " + describe_reply(greeting));
+            co_return;
+        }
+
+        LOG_NETWORK_DEBUG("Greeting on {}:{} identified as {}", target(), port(), matched->name());
+        auto conn = release_connection();
+        matched->async_probe_connected(
+            std::move(conn), target(), port(), timeout(),
+            [group = group_, matched](ProtocolResult&& r) {
+                group->finish(std::move(r), matched);
+            });
+    }
+
+    IProtocol* classify(std::string_view greeting) const {
+        IProtocol* best = nullptr;
+        int best_score = 0;
+        bool best_default = false;
+        for (auto* p : group_->candidates) {
+            int score = p->match_greeting(greeting);
+            if (score == 0 || score < best_score) continue;
+            const auto defaults = p->default_ports();
+            bool is_default = std::find(defaults.begin(), defaults.end(), port()) != defaults.end();
+            if (score > best_score || (is_default && !best_default)) {
+                best = p;
+                best_score = score;
+                best_default = is_default;
+            }
+        }
+        return best;
+    }
+
+    std::shared_ptr<BannerGroup> group_;
+};
+
+} // namespace
+
+void async_banner_probe(
+    const std::vector<IProtocol*>& candidates,
+    const std::string& target,
+    const std::string& ip,
+    Port port,
+    Timeout timeout,
+    boost::asio::any_io_executor exec,
+    std::function<void(std::vector<ProtocolResult>&&)> on_complete
+) {
+    // 空闲催促：端口是任一候选的默认端口时不催促，否则取候选中最短的阈值
+    Timeout idle{0};
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        Timeout t = candidates[i]->idle_nudge(port);
+        if (t.count() == 0) {
+            idle = Timeout(0);
+            break;
+        }
+        idle = i == 0 ? t : std::min(idle, t);
+    }
+    std::string_view nudge = candidates.empty() ? std::string_view() : candidates.front()->idle_nudge_payload();
+
+    auto group = std::allocate_shared<BannerGroup>(ProbeAllocator<BannerGroup>(),
+                                                   BannerGroup{candidates, std::move(on_complete)});
+    ProbeEngine<BannerProbe>::launch(
+        ProbeParams{"BANNER", target, ip, port, timeout, std::move(exec),
+                    [group](ProtocolResult&& r) { group->finish(std::move(r), nullptr); }, false, idle, nudge},
+        group);
+}
+
+} // namespace scanner
@@ -0,0 +1,111 @@
+#include "scanner/protocols/cert_cache.h"
+#include "scanner/common/logger.h"
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <mutex>
+
+namespace scanner {
+
+namespace {
+
+std::string bio_to_string(BIO* bio) {
+    char* data = nullptr;
+    long len = BIO_get_mem_data(bio, &data);
+    return len > 0 ? std::string(data, static_cast<std::size_t>(len)) : std::string();
+}
+
+std::string name_to_string(X509_NAME* name) {
+    std::unique_ptr<BIO, decltype(&BIO_free)> bio(BIO_new(BIO_s_mem()), &BIO_free);
+    if (!bio || !name) return {};
+    X509_NAME_print_ex(bio.get(), name, 0, XN_FLAG_RFC2253);
+    return bio_to_string(bio.get());
+}
+
+std::string time_to_string(const ASN1_TIME* t) {
+    std::unique_ptr<BIO, decltype(&BIO_free)> bio(BIO_new(BIO_s_mem()), &BIO_free);
+    if (!bio || !t) return {};
+    ASN1_TIME_print(bio.get(), t);
+    return bio_to_string(bio.get());
+}
+
+std::string to_hex(const unsigned char* data, std::size_t len) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string out(len * 2, '\0');
+    for (std::size_t i = 0; i < len; ++i) {
+        out[2 * i] = kHex[data[i] >> 4];
+        out[2 * i + 1] = kHex[data[i] & 0x0f];
+    }
+    return out;
+}
+
+} // namespace
+
+uint32_t CertificateCache::intern(std::string_view der) {
+    if (der.empty()) return 0;
+
+    Digest digest;
+    unsigned int digest_len = 0;
+    if (!EVP_Digest(der.data(), der.size(), digest.data(), &digest_len, EVP_sha256(), nullptr) ||
+        digest_len != digest.size()) {
+        return 0;
+    }
+
+    {
+        std::shared_lock lock(mutex_);
+        auto it = by_digest_.find(digest);
+        if (it != by_digest_.end()) {
+            entries_[it->second - 1]->seen.fetch_add(1, std::memory_order_relaxed);
+            references_.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+
+    // 首次出现：在锁外解析
+    const auto* p = reinterpret_cast<const unsigned char*>(der.data());
+    std::unique_ptr<X509, decltype(&X509_free)> cert(
+        d2i_X509(nullptr, &p, static_cast<long>(der.size())), &X509_free);
+    if (!cert) {
+        LOG_NETWORK_DEBUG("Unparsable peer certificate ({} bytes)", der.size());
+        return 0;
+    }
+    auto info = std::make_unique<CertificateInfo>();
+    info->sha256 = to_hex(digest.data(), digest.size());
+    info->subject = name_to_string(X509_get_subject_name(cert.get()));
+    info->issuer = name_to_string(X509_get_issuer_name(cert.get()));
+    info->not_after = time_to_string(X509_get0_notAfter(cert.get()));
+    info->seen.store(1, std::memory_order_relaxed);
+
+    std::unique_lock lock(mutex_);
+    references_.fetch_add(1, std::memory_order_relaxed);
+    auto [it, inserted] = by_digest_.try_emplace(digest, static_cast<uint32_t>(entries_.size() + 1));
+    if (!inserted) {
+        entries_[it->second - 1]->seen.fetch_add(1, std::memory_order_relaxed);
+        return it->second;
+    }
+    info->id = it->second;
+    entries_.push_back(std::move(info));
+    return it->second;
+}
+
+const CertificateInfo* CertificateCache::find(uint32_t id) const {
+    std::shared_lock lock(mutex_);
+    if (id == 0 || id > entries_.size()) return nullptr;
+    return entries_[id - 1].get();
+}
+
+std::size_t CertificateCache::size() const {
+    std::shared_lock lock(mutex_);
+    return entries_.size();
+}
+
+void CertificateCache::write_table(std::ostream& os) const {
+    std::shared_lock lock(mutex_);
+    os << "id\tsha256\tseen\tnot_after\tsubject\tissuer\n";
+    for (const auto& e : entries_) {
+        os << e->id << '\t' << e->sha256 << '\t' << e->seen.load(std::memory_order_relaxed) << '\t'
+           << e->not_after << '\t' << e->subject << '\t' << e->issuer << '\n';
+    }
+}
+
+} // namespace scanner
@@ -1,50 +1,85 @@
 #include "scanner/protocols/ftp_protocol.h"
+#include "scanner/protocols/probe_engine.h"
 #include "scanner/common/logger.h"
-#include <boost/asio/read_until.hpp>
-#include <boost/asio/streambuf.hpp>
 
 namespace scanner {
 
-namespace asio = boost::asio;
-using tcp = asio::ip::tcp;
-using steady_timer = asio::steady_timer;
-
-struct FtpProbeContext {
-    ProtocolResult result;
-    tcp::socket socket;
-    steady_timer timer;
-    asio::streambuf buffer;
-    Timeout timeout;
-    std::function<void(ProtocolResult&&)> on_complete;
-    std::chrono::steady_clock::time_point start_time;
-    bool completed{false};
-
-    FtpProbeContext(boost::asio::any_io_executor exec, Timeout t, std::function<void(ProtocolResult&&)> cb)
-        : socket(std::move(exec)), timer(socket.get_executor()), timeout(t), on_complete(std::move(cb)) {}
-
-    void finish_success() {
-        result.accessible = true;
-        auto end = std::chrono::steady_clock::now();
-        result.attrs.response_time_ms =
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time).count();
-        complete();
+// =====================
+// FTP 探测步骤
+// =====================
+
+class FtpProtocol::Probe : public ProbeEngine<FtpProtocol::Probe> {
+public:
+    Probe(ProbeParams&& params, const FtpProtocol& proto)
+        : ProbeEngine(std::move(params)), proto_(proto) {}
+
+private:
+    friend class ProbeEngine<Probe>;
+
+    // FTP 服务通常会先返回 220 欢迎语，读取首行作为 banner。
+    // 开启抢先发送时连接后立即写出 FEAT 与 SYST（两者在登录前均可用），
+    // 读完欢迎语后依次取两段应答，分别记为 fields 中的 feat / syst。
+    ProbeTask run() {
+        static const std::string feat_syst_cmd = "FEAT\r\nSYST\r\n";
+        const bool early = proto_.optimistic_enabled();
+        if (early) co_await write(feat_syst_cmd, "FEAT");
+
+        auto line = co_await read_line("banner");
+        banner().assign(line);
+        if (!early) {
+            finish_success();
+            co_return;
+        }
+        settle();
+
+        // 多行欢迎语（"220-" 开头）读到 "220 " 结束行为止，中间行可能不带应答码
+        co_await skip_reply(line, "banner");
+
+        // FEAT："211-Features:" 后每个特性一行（以空格开头），"211 End" 结束
+        line = co_await read_line("FEAT");
+        if (line.substr(0, 4) == "211-") {
+            std::string features;
+            for (;;) {
+                line = co_await read_line("FEAT");
+                if (line.substr(0, 4) == "211 ") break;
+                while (!line.empty() && line.front() == ' ') line.remove_prefix(1);
+                if (line.empty()) continue;
+                if (!features.empty()) features += ',';
+                features += line;
+            }
+            attrs().fields.emplace_back("feat", std::move(features));
+        } else {
+            co_await skip_reply(line, "FEAT");
+        }
+
+        // SYST："215 UNIX Type: L8"；未登录时不少服务器回 530
+        line = co_await read_line("SYST");
+        if (line.substr(0, 4) == "215 ") {
+            attrs().fields.emplace_back("syst", std::string(line.substr(4)));
+        }
+        finish_success();
     }
 
-    void finish_error(const std::string& msg) {
-        result.error = msg;
-        complete();
+    // first 为某个应答的首行；若是多行应答（"xyz-"），继续读到 "xyz " 结束行
+    ProbeTask skip_reply(std::string_view first, const char* what) {
+        if (first.size() < 4 || first[3] != '-') co_return;
+        const std::string end = std::string(first.substr(0, 3)) + ' ';
+        for (;;) {
+            auto line = co_await read_line(what);
+            if (line.substr(0, 4) == end) break;
+        }
     }
 
-    void complete() {
-        if (completed) return;
-        completed = true;
-        boost::system::error_code ec;
-        (void)timer.cancel();
-        socket.close(ec);
-        if (on_complete) {
-            on_complete(std::move(result));
+    // 连接后对端直接关闭也视为端口开放
+    bool on_read_error(const boost::system::error_code& ec, const char* what) {
+        if (ec == asio::error::eof) {
+            finish_success();
+            return false;
         }
+        return ProbeEngine::on_read_error(ec, what);
     }
+
+    const FtpProtocol& proto_;
 };
 
 void FtpProtocol::async_probe(
@@ -55,59 +90,37 @@ void FtpProtocol::async_probe(
     boost::asio::any_io_executor exec,
     std::function<void(ProtocolResult&&)> on_complete
 ) {
-    auto ctx = std::make_shared<FtpProbeContext>(std::move(exec), timeout, std::move(on_complete));
-    ctx->result.protocol = name();
-    ctx->result.host = target;
-    ctx->result.port = port;
-    ctx->start_time = std::chrono::steady_clock::now();
-
-    ctx->timer.expires_after(timeout);
-    ctx->timer.async_wait([ctx](const boost::system::error_code& ec) {
-        if (!ec) {
-            ctx->finish_error("FTP probe timed out");
-        }
-    });
-
-    boost::system::error_code ec;
-    auto address = asio::ip::make_address(ip, ec);
-    if (ec) {
-        ctx->finish_error("Invalid address: " + ec.message());
-        return;
-    }
+    ProbeEngine<Probe>::launch(
+        ProbeParams{name(), target, ip, port, timeout, std::move(exec), std::move(on_complete), requires_tls(port),
+                    idle_nudge(port), idle_nudge_payload()},
+        *this);
+}
 
-    tcp::endpoint endpoint(address, port);
-    ctx->socket.async_connect(endpoint, [this, ctx](const boost::system::error_code& ec) {
-        if (ec) {
-            ctx->finish_error("Connection failed: " + ec.message());
-            return;
-        }
+// "220" 同时是 SMTP 的欢迎码，首行提到 FTP 才算明确匹配
+int FtpProtocol::match_greeting(std::string_view greeting) const {
+    std::string_view line;
+    if (!next_line(greeting, line) || line.substr(0, 3) != "220") return 0;
+    return find_ignore_case(line, "ftp") != std::string_view::npos ? 2 : 1;
+}
 
-        // FTP 服务通常会先返回 220 欢迎语，读取首行作为 banner。
-        asio::async_read_until(ctx->socket, ctx->buffer, "\r\n",
-            [this, ctx](const boost::system::error_code& ec, std::size_t /*bytes*/) {
-                if (ec && ec != asio::error::eof) {
-                    ctx->finish_error("Read banner failed: " + ec.message());
-                    return;
-                }
-
-                std::istream is(&ctx->buffer);
-                std::string line;
-                if (std::getline(is, line)) {
-                    if (!line.empty() && line.back() == '\r') line.pop_back();
-                    ctx->result.attrs.banner = line;
-                    parse_capabilities(line, ctx->result.attrs);
-                }
-
-                ctx->finish_success();
-            });
-    });
+void FtpProtocol::async_probe_connected(
+    ProbeConnection&& conn,
+    const std::string& target,
+    Port port,
+    Timeout timeout,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    auto exec = conn.socket.get_executor();
+    ProbeEngine<Probe>::adopt(
+        ProbeParams{name(), target, {}, port, timeout, std::move(exec), std::move(on_complete)},
+        std::move(conn), *this);
 }
 
 void FtpProtocol::parse_capabilities(
     const std::string& response,
     ProtocolAttributes& attrs
 ) {
-    // 目前仅提取 Banner，未来可扩展 FEAT/SYST 解析
+    // 仅提取 Banner；FEAT / SYST 在探测中解析（见 set_optimistic）
     if (attrs.banner.empty()) {
         attrs.banner = response;
     }
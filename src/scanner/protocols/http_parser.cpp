@@ -0,0 +1,167 @@
+#include "scanner/protocols/http_parser.h"
+#include <cctype>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace scanner {
+
+namespace {
+
+inline bool is_ctl(unsigned char c) {
+    return (c < 0x20 && c != '\t') || c == 0x7f;
+}
+
+// [p, end) 中第一个控制字符（\t 除外）；行尾的 \r / \n 也在其中
+const char* find_ctl(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i c1f = _mm_set1_epi8(0x1f);
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(v, c1f), v);   // 无符号 v <= 0x1f
+        ctl = _mm_andnot_si128(_mm_cmpeq_epi8(v, tab), ctl);
+        ctl = _mm_or_si128(ctl, _mm_cmpeq_epi8(v, del));
+        if (int mask = _mm_movemask_epi8(ctl)) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && !is_ctl(static_cast<unsigned char>(*p))) ++p;
+    return p;
+}
+
+// 头部名的结束位置：第一个 ':'、空白、控制字符
+const char* find_name_end(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i c20 = _mm_set1_epi8(0x20);
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i stop = _mm_cmpeq_epi8(_mm_min_epu8(v, c20), v);   // 无符号 v <= 0x20
+        stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, colon));
+        stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, del));
+        if (int mask = _mm_movemask_epi8(stop)) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        auto c = static_cast<unsigned char>(*p);
+        if (c <= 0x20 || c == ':' || c == 0x7f) break;
+    }
+    return p;
+}
+
+// 从 p 切出一行（不含行尾），next 指向下一行；接受 "\r\n" 与单独的 "\n"
+HttpParseStatus take_line(const char* p, const char* end, std::string_view& line, const char*& next) {
+    const char* e = find_ctl(p, end);
+    if (e == end) return HttpParseStatus::Partial;
+    if (*e == '\r') {
+        if (e + 1 == end) return HttpParseStatus::Partial;
+        if (e[1] != '\n') return HttpParseStatus::Invalid;
+        next = e + 2;
+    } else if (*e == '\n') {
+        next = e + 1;
+    } else {
+        return HttpParseStatus::Invalid;
+    }
+    line = std::string_view(p, static_cast<std::size_t>(e - p));
+    return HttpParseStatus::Complete;
+}
+
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// "HTTP/1.1 200 OK"：协议名不区分大小写，原因短语可省略
+bool parse_status_line(std::string_view line, HttpResponseHead& out) {
+    if (line.size() < 12) return false;
+    static constexpr std::string_view kProto = "http/";
+    for (std::size_t i = 0; i < kProto.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(line[i])) != kProto[i]) return false;
+    }
+    if (line[5] != '1' || line[6] != '.' || !is_digit(line[7]) || line[8] != ' ') return false;
+    if (!is_digit(line[9]) || !is_digit(line[10]) || !is_digit(line[11])) return false;
+    if (line.size() > 12 && line[12] != ' ') return false;
+
+    out.status_line = line;
+    out.minor_version = line[7] - '0';
+    out.status = (line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0');
+    out.reason = line.size() > 13 ? line.substr(13) : std::string_view();
+    return true;
+}
+
+inline std::string_view trim_ows(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+} // namespace
+
+std::string_view HttpResponseHead::find(std::string_view name) const {
+    for (std::size_t i = 0; i < num_headers; ++i) {
+        std::string_view n = headers[i].name;
+        if (n.size() != name.size()) continue;
+        bool same = true;
+        for (std::size_t k = 0; k < n.size() && same; ++k) {
+            same = std::tolower(static_cast<unsigned char>(n[k])) == name[k];
+        }
+        if (same) return headers[i].value;
+    }
+    return {};
+}
+
+HttpParseStatus parse_http_response(std::string_view buf, HttpResponseHead& out) {
+    const char* p = buf.data();
+    const char* const end = p + buf.size();
+
+    // 状态行；没有行尾时仍按已收到的部分取状态码（对端发完即关闭的情况）
+    std::string_view line;
+    const char* next = nullptr;
+    HttpParseStatus st = take_line(p, end, line, next);
+    if (st == HttpParseStatus::Partial) {
+        parse_status_line(std::string_view(p, static_cast<std::size_t>(find_ctl(p, end) - p)), out);
+        return st;
+    }
+    if (st == HttpParseStatus::Invalid || !parse_status_line(line, out)) return HttpParseStatus::Invalid;
+    p = next;
+
+    for (;;) {
+        if (p == end) return HttpParseStatus::Partial;
+
+        // 空行：头部结束
+        if (*p == '\r') {
+            if (p + 1 == end) return HttpParseStatus::Partial;
+            if (p[1] != '\n') return HttpParseStatus::Invalid;
+            p += 2;
+            break;
+        }
+        if (*p == '\n') {
+            ++p;
+            break;
+        }
+
+        std::string_view name;
+        const char* value_begin = p;
+        if (*p != ' ' && *p != '\t') {
+            const char* name_end = find_name_end(p, end);
+            if (name_end == end) return HttpParseStatus::Partial;
+            if (*name_end != ':' || name_end == p) return HttpParseStatus::Invalid;
+            name = std::string_view(p, static_cast<std::size_t>(name_end - p));
+            value_begin = name_end + 1;
+        }
+
+        std::string_view value;
+        st = take_line(value_begin, end, value, next);
+        if (st != HttpParseStatus::Complete) return st;
+        if (out.num_headers < HttpResponseHead::kMaxHeaders) {
+            out.headers[out.num_headers++] = HttpHeaderField{name, trim_ows(value)};
+        }
+        p = next;
+    }
+
+    out.header_length = static_cast<std::size_t>(p - buf.data());
+    return HttpParseStatus::Complete;
+}
+
+} // namespace scanner
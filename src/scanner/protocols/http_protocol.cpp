@@ -1,62 +1,305 @@
 #include "scanner/protocols/http_protocol.h"
+#include "scanner/protocols/http_parser.h"
+#include "scanner/protocols/probe_engine.h"
 #include "scanner/common/logger.h"
-#include <boost/asio/write.hpp>
-#include <boost/asio/read_until.hpp>
-#include <boost/asio/streambuf.hpp>
-#include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <optional>
+#include <unordered_map>
 
 namespace scanner {
 
-namespace asio = boost::asio;
-using tcp = asio::ip::tcp;
-using steady_timer = asio::steady_timer;
+// =====================
+// HTTP 探测步骤
+// =====================
 
-// 辅助函数：不区分大小写的前缀检查
-static bool starts_with_ignore_case(const std::string& str, const std::string& prefix) {
-    if (str.length() < prefix.length()) return false;
-    return std::equal(prefix.begin(), prefix.end(), str.begin(),
-                     [](char a, char b) { return std::tolower(a) == std::tolower(b); });
-}
+class HttpProtocol::Probe : public ProbeEngine<HttpProtocol::Probe> {
+public:
+    // lane_key 非空表示经虚拟主机批处理启动，结束时把连接（若可复用）交还给 Lanes；
+    // uses 为此前已在该连接上完成的探测数
+    Probe(ProbeParams&& params, HttpProtocol& proto, std::string lane_key = {}, std::size_t uses = 0)
+        : ProbeEngine(std::move(params)), proto_(proto), lane_key_(std::move(lane_key)), uses_(uses) {}
+
+private:
+    friend class ProbeEngine<Probe>;
+
+    static constexpr std::size_t kMaxBody = 16 * 1024;   // 单个响应体最多读取的字节，超过即放弃该连接
+    static constexpr std::size_t kMaxUses = 100;         // 单个连接上最多完成的探测数
+
+    // 响应头决定的响应体定界方式
+    struct Framing {
+        bool complete = false;     // 响应头完整
+        bool interim = false;      // 1xx 临时响应，真正的响应随后到达
+        bool no_body = false;      // HEAD、1xx、204、304
+        bool chunked = false;
+        bool has_length = false;
+        bool close = false;        // Connection: close
+        std::size_t length = 0;
+    };
+
+    // 请求模仿 curl（默认的 HEAD / 即 curl -I），使用 target 作为 Host 标识。
+    // 全部请求一次写出（流水线），按顺序读响应，响应体按 Content-Length / chunked 定界后丢弃。
+    // 对端提前关闭、响应无法定界或响应体过大时，剩余请求在新连接上重发；新连接一个响应都没有时停止
+    ProbeTask run() {
+        const auto& specs = proto_.requests_;
+        while (next_ < specs.size()) {
+            if (connections_++ > 0) co_await reconnect();
+            build_requests();
+            co_await write(request_, "request");
+
+            std::size_t first = next_;
+            closed_ = false;
+            reusable_ = true;
+            while (next_ < specs.size() && reusable_) {
+                co_await read_response();
+            }
+            if (next_ == first) {
+                // 接手的连接可能已被对端关闭：换新连接重试一次
+                if (retry_reused()) continue;
+                break;
+            }
+        }
+
+        // 连接仍可复用时留给同一 IP 上排队的下一个探测
+        if (!lane_key_.empty() && reusable_ && !closed_ && !tls_active() && uses_ + 1 < kMaxUses) {
+            keep_ = take_connection();
+            keep_->uses = uses_ + 1;
+            if (!keep_->buffer.empty()) keep_.reset();   // 多出的数据会错配到下一个探测
+        }
+        finish_success();
+    }
+
+    void on_finished();
+
+    bool retry_reused() const { return uses_ > 0 && connections_ == 1; }
+
+    // 对端关闭时按已收到的内容处理；第一个响应之后（或接手的连接上）的读失败只结束当前连接
+    bool on_read_error(const boost::system::error_code& ec, const char* what) {
+        if (ec == asio::error::eof || next_ > 0 || retry_reused()) {
+            closed_ = true;
+            return true;
+        }
+        return ProbeEngine::on_read_error(ec, what);
+    }
+
+    void build_requests() {
+        request_.clear();
+        for (std::size_t i = next_; i < proto_.requests_.size(); ++i) {
+            const auto& spec = proto_.requests_[i];
+            request_ += spec.method;
+            request_ += ' ';
+            request_ += spec.path;
+            request_ += " HTTP/1.1\r\n"
+                        "Host: ";
+            request_ += target();
+            request_ += "\r\n"
+                        "User-Agent: curl/8.7.1\r\n"
+                        "Accept: */*\r\n"
+                        "\r\n";
+        }
+    }
+
+    // 读取 requests_[next_] 的响应；reusable_ 表示连接上还能继续读下一个响应
+    ProbeTask read_response() {
+        reusable_ = false;
+        Framing f;
+        do {
+            auto data = co_await read_until("\r\n\r\n", "response");
+            // 第一个请求之后（或接手的连接上），对端未作答即关闭：留给新连接
+            if (data.empty() && (next_ > 0 || retry_reused())) co_return;
+            f = on_head(data);
+        } while (f.interim && !closed_);
+        ++next_;
+        if (!f.complete || closed_) co_return;
+
+        if (f.no_body) {
+            reusable_ = !f.close;
+            co_return;
+        }
+        // 既无 Content-Length 也非 chunked：响应体读到连接关闭为止，连接不能再复用
+        if (!f.chunked && !f.has_length) co_return;
+        if (f.has_length && f.length > kMaxBody) co_return;
+
+        if (f.chunked) {
+            co_await skip_chunked();
+        } else {
+            co_await skip_body(f.length);
+        }
+        reusable_ = body_ok_ && !closed_ && !f.close;
+    }
+
+    // 丢弃 n 字节响应体；body_ok_ 表示完整读完
+    ProbeTask skip_body(std::size_t n) {
+        body_ok_ = false;
+        while (n > 0) {
+            std::size_t chunk = std::min(n, RecvBuffer::kCapacity);
+            auto data = co_await read_exact(chunk, "body");
+            if (data.size() < chunk) co_return;
+            n -= chunk;
+        }
+        body_ok_ = true;
+    }
+
+    // 丢弃 chunked 响应体（含尾部字段），累计超过 kMaxBody 时放弃
+    ProbeTask skip_chunked() {
+        std::size_t total = 0;
+        for (;;) {
+            body_ok_ = false;
+            auto line = co_await read_line("chunk size");
+            std::size_t size = 0;
+            auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), size, 16);
+            if (ec != std::errc() || closed_) co_return;
+            if (size == 0) break;
+            total += size;
+            if (total > kMaxBody) co_return;
+            co_await skip_body(size + 2);   // 数据后的 "\r\n"
+            if (!body_ok_) co_return;
+        }
+        body_ok_ = false;
+        for (;;) {
+            auto line = co_await read_line("trailer");
+            if (closed_) co_return;
+            if (line.empty()) break;
+        }
+        body_ok_ = true;
+    }
+
+    // 解析响应头并记录结果：第一个请求写入 http 属性与 Banner，其余各记一条 fields
+    Framing on_head(std::string_view response) {
+        HttpResponseHead head;
+        HttpParseStatus st = parse_http_response(response, head);
+
+        Framing f;
+        f.complete = st == HttpParseStatus::Complete;
+        if (f.complete && head.status >= 100 && head.status < 200 && head.status != 101) {
+            f.interim = true;
+            return f;
+        }
+
+        if (next_ == 0) {
+            on_first_response(response, head);
+            settle();
+        } else {
+            std::string value = std::to_string(head.status);
+            if (!head.reason.empty()) {
+                value += ' ';
+                value.append(head.reason);
+            }
+            attrs().fields.emplace_back(proto_.requests_[next_].path, std::move(value));
+        }
+
+        f.no_body = proto_.requests_[next_].method == "HEAD" || head.status < 200 ||
+                    head.status == 204 || head.status == 304;
+        // HTTP/1.0 默认不保持连接
+        auto connection = head.find("connection");
+        f.close = find_ignore_case(connection, "close") != std::string_view::npos ||
+                  (head.minor_version == 0 && find_ignore_case(connection, "keep-alive") == std::string_view::npos);
+        f.chunked = find_ignore_case(head.find("transfer-encoding"), "chunked") != std::string_view::npos;
+        if (auto cl = head.find("content-length"); !cl.empty() && !f.chunked) {
+            auto [ptr, ec] = std::from_chars(cl.data(), cl.data() + cl.size(), f.length);
+            f.has_length = ec == std::errc() && ptr == cl.data() + cl.size();
+        }
+        return f;
+    }
+
+    void on_first_response(std::string_view response, const HttpResponseHead& head) {
+        auto& a = attrs();
+        apply_head(head, a);
+
+        // 组合 Banner
+        banner().assign(head.status_line);
+        if (!a.http.server.empty()) {
+            banner().append(" [");
+            banner().append(a.http.server);
+            banner().append("]");
+        }
+
+        // 深度扫描：如果是错误码或者是通用的负载均衡器标识，留下响应，由 enrich 在 CPU 线程池上查找各服务端特征
+        bool is_generic = (a.http.server.find("Lego") != std::string::npos ||
+                          a.http.server.find("NWS") != std::string::npos ||
+                          a.http.server.empty());
 
-struct HttpProbeContext {
-    ProtocolResult result;
-    tcp::socket socket;
-    steady_timer timer;
-    asio::streambuf buffer;
-    Timeout timeout;
-    std::function<void(ProtocolResult&&)> on_complete;
-    std::chrono::steady_clock::time_point start_time;
-    bool completed{false};
-
-    HttpProbeContext(boost::asio::any_io_executor exec, Timeout t, std::function<void(ProtocolResult&&)> cb)
-        : socket(std::move(exec)), timer(socket.get_executor()), timeout(t), on_complete(std::move(cb)) {}
-
-    void finish_success() {
-        result.accessible = true;
-        auto end = std::chrono::steady_clock::now();
-        result.attrs.response_time_ms =
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time).count();
-        complete();
+        if (a.http.status_code >= 400 || is_generic) {
+            result().raw.assign(response);
+        }
     }
 
-    void finish_error(const std::string& msg) {
-        result.error = msg;
-        complete();
+    HttpProtocol& proto_;
+    std::string lane_key_;
+    std::size_t uses_ = 0;
+    std::optional<ProbeConnection> keep_;   // 结束时交还 Lanes 的连接
+    std::string request_;
+    std::size_t next_ = 0;          // 下一个待读响应对应的请求下标
+    std::size_t connections_ = 0;
+    bool closed_ = false;           // 当前连接已被对端关闭（或读失败）
+    bool reusable_ = false;
+    bool body_ok_ = false;
+};
+
+// =====================
+// 虚拟主机批处理
+// =====================
+// 每个 IO 线程一份（线程局部，只在该线程访问）：按目标 IP:端口分道，每道最多 vhost_connections_ 个连接
+// 同时进行，其余探测排队；探测结束时若连接仍可复用就直接交给队首探测（adopt），否则队首探测新建连接。
+// 不保留空闲连接：没有排队者时连接随探测结束关闭。排队已满时不再等待，直接新建连接。
+
+class HttpProtocol::Lanes {
+public:
+    static Lanes& local() {
+        thread_local Lanes lanes;
+        return lanes;
     }
 
-    void complete() {
-        if (completed) return;
-        completed = true;
-        boost::system::error_code ec;
-        (void)timer.cancel();
-        socket.close(ec);
-        if (on_complete) {
-            on_complete(std::move(result));
+    void acquire(HttpProtocol& proto, ProbeParams params) {
+        std::string key = params.ip + '|' + std::to_string(params.port);
+        Lane& lane = lanes_[key];
+        if (lane.active >= proto.vhost_connections_ && lane.waiting.size() < kMaxWaiting) {
+            lane.waiting.push_back(std::move(params));
+            return;
         }
+        ++lane.active;
+        ProbeEngine<Probe>::launch(std::move(params), proto, std::move(key), std::size_t{0});
     }
+
+    void release(HttpProtocol& proto, const std::string& key, std::optional<ProbeConnection> conn) {
+        auto it = lanes_.find(key);
+        if (it == lanes_.end()) return;
+        Lane& lane = it->second;
+        if (lane.waiting.empty()) {
+            if (--lane.active == 0) lanes_.erase(it);
+            return;
+        }
+
+        ProbeParams next = std::move(lane.waiting.front());
+        lane.waiting.pop_front();
+        if (conn) {
+            std::size_t uses = conn->uses;
+            conn->connected_at = std::chrono::steady_clock::now();
+            ProbeEngine<Probe>::adopt(std::move(next), std::move(*conn), proto, key, uses);
+        } else {
+            ProbeEngine<Probe>::launch(std::move(next), proto, key, std::size_t{0});
+        }
+    }
+
+private:
+    static constexpr std::size_t kMaxWaiting = 64;   // 每道排队上限
+
+    struct Lane {
+        std::size_t active = 0;             // 进行中的探测（各占一个连接）
+        std::deque<ProbeParams> waiting;
+    };
+
+    std::unordered_map<std::string, Lane> lanes_;
 };
 
+void HttpProtocol::Probe::on_finished() {
+    if (!lane_key_.empty()) {
+        Lanes::local().release(proto_, lane_key_, std::move(keep_));
+    }
+}
+
 void HttpProtocol::async_probe(
     const std::string& target,
     const std::string& ip,
@@ -65,134 +308,67 @@ void HttpProtocol::async_probe(
     boost::asio::any_io_executor exec,
     std::function<void(ProtocolResult&&)> on_complete
 ) {
-    auto ctx = std::make_shared<HttpProbeContext>(std::move(exec), timeout, std::move(on_complete));
-    ctx->result.protocol = name();
-    ctx->result.host = target;
-    ctx->result.port = port;
-    ctx->start_time = std::chrono::steady_clock::now();
-
-    ctx->timer.expires_after(timeout);
-    ctx->timer.async_wait([ctx](const boost::system::error_code& ec) {
-        if (!ec) {
-            ctx->finish_error("HTTP probe timed out");
-        }
-    });
-
-    boost::system::error_code ec;
-    auto address = asio::ip::make_address(ip, ec);
-    if (ec) {
-        ctx->finish_error("Invalid address: " + ec.message());
+    bool tls = requires_tls(port);
+    if (vhost_connections_ == 0 || tls) {
+        ProbeEngine<Probe>::launch(
+            ProbeParams{name(), target, ip, port, timeout, std::move(exec), std::move(on_complete), tls}, *this);
         return;
     }
-
-    tcp::endpoint endpoint(address, port);
-    ctx->socket.async_connect(endpoint, [this, ctx, target](const boost::system::error_code& ec) {
-        if (ec) {
-            ctx->finish_error("Connection failed: " + ec.message());
-            return;
-        }
-
-        // 使用完全伪装的 HEAD 请求（模仿 curl -I），使用 target 作为 Host 标识
-        auto request = std::make_shared<std::string>(
-            "HEAD / HTTP/1.1\r\n"
-            "Host: " + target + "\r\n"
-            "User-Agent: curl/8.7.1\r\n"
-            "Accept: */*\r\n"
-            "\r\n"
-        );
-
-        asio::async_write(ctx->socket, asio::buffer(*request),
-            [this, ctx, request](const boost::system::error_code& ec, std::size_t /*bytes*/) {
-                if (ec) {
-                    ctx->finish_error("Write request failed: " + ec.message());
-                    return;
-                }
-
-                // 读取响应头
-                asio::async_read_until(ctx->socket, ctx->buffer, "\r\n\r\n",
-                    [this, ctx](const boost::system::error_code& ec, std::size_t /*bytes*/) {
-                        if (ec && ec != asio::error::eof) {
-                            ctx->finish_error("Read response failed: " + ec.message());
-                            return;
-                        }
-
-                        std::string full_response{
-                            asio::buffers_begin(ctx->buffer.data()),
-                            asio::buffers_end(ctx->buffer.data())
-                        };
-                        
-                        // 提取状态行
-                        auto first_line_end = full_response.find("\r\n");
-                        std::string status_line = (first_line_end != std::string::npos) ? 
-                                                 full_response.substr(0, first_line_end) : "";
-                        
-                        parse_capabilities(full_response, ctx->result.attrs);
-                        
-                        // 更新组合 Banner
-                        std::string final_banner = status_line;
-                        if (!ctx->result.attrs.http.server.empty()) {
-                            final_banner += " [" + ctx->result.attrs.http.server + "]";
-                        }
-                        ctx->result.attrs.banner = final_banner;
-                        
-                        // 深度扫描：如果是错误码或者是通用的负载均衡器标识，则在 Body 中精确搜索
-                        bool is_generic = (ctx->result.attrs.http.server.find("Lego") != std::string::npos ||
-                                          ctx->result.attrs.http.server.find("NWS") != std::string::npos ||
-                                          ctx->result.attrs.http.server.empty());
-
-                        if (ctx->result.attrs.http.status_code >= 400 || is_generic) 
-                        {
-                            std::string lower_resp = full_response;
-                            std::transform(lower_resp.begin(), lower_resp.end(), lower_resp.begin(), ::tolower);
-                            
-                            std::vector<std::string> signatures = {"nginx/", "apache/", "iis/", "litespeed"};
-                            for (const auto& sig : signatures) {
-                                auto pos = lower_resp.find(sig);
-                                if (pos != std::string::npos) {
-                                    // 提取版本号（到空格、换行、或 HTML 标签结束）
-                                    auto end_pos = full_response.find_first_of(" \r\n<\"", pos);
-                                    std::string found = full_response.substr(pos, end_pos - pos);
-                                    ctx->result.attrs.banner += " (Detected: " + found + ")";
-                                    break;
-                                }
-                            }
-                        }
-
-                        ctx->finish_success();
-                    });
-            });
+    // 分道状态在 IO 线程上
+    auto io = exec;
+    asio::post(io, [this, params = ProbeParams{name(), target, ip, port, timeout, std::move(exec),
+                                                std::move(on_complete), false}]() mutable {
+        Lanes::local().acquire(*this, std::move(params));
     });
 }
 
+HttpRequestSpec HttpRequestSpec::parse(std::string_view spec) {
+    auto trim = [](std::string_view v) {
+        while (!v.empty() && std::isspace(static_cast<unsigned char>(v.front()))) v.remove_prefix(1);
+        while (!v.empty() && std::isspace(static_cast<unsigned char>(v.back()))) v.remove_suffix(1);
+        return v;
+    };
+    spec = trim(spec);
+    HttpRequestSpec r{"GET", "/"};
+    auto space = spec.find(' ');
+    if (space != std::string_view::npos) {
+        r.method.assign(spec.substr(0, space));
+        std::transform(r.method.begin(), r.method.end(), r.method.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        spec = trim(spec.substr(space + 1));
+    }
+    if (!spec.empty()) r.path.assign(spec);
+    return r;
+}
+
 void HttpProtocol::parse_capabilities(
     const std::string& response,
     ProtocolAttributes& attrs
 ) {
-    std::istringstream oss(response);
-    std::string line;
-    std::string status_line;
-
-    while (std::getline(oss, line)) {
-        if (line.back() == '\r') line.pop_back();
-        if (line.empty()) {
-            break;
-        }
-
-        if (status_line.empty() && starts_with_ignore_case(line, "HTTP/")) {
-            status_line = line;
-            auto space = line.find(' ');
-            if (space != std::string::npos) {
-                auto code_str = line.substr(space + 1, 3);
-                try {
-                    attrs.http.status_code = std::stoi(code_str);
-                } catch (...) {}
-            }
-        } else if (starts_with_ignore_case(line, "Server: ")) {
-            attrs.http.server = line.substr(8);
-        } else if (starts_with_ignore_case(line, "Content-Type: ")) {
-            attrs.http.content_type = line.substr(14);
-        }
-    }
+    HttpResponseHead head;
+    parse_http_response(response, head);
+    apply_head(head, attrs);
+}
+
+void HttpProtocol::enrich(ProtocolResult& r) const {
+    static constexpr NeedleSet<4> signatures({"nginx/", "apache/", "iis/", "litespeed"});
+    std::string_view response = r.raw;
+    auto hit = signatures.find(response);
+    if (hit.index == 4) return;
+
+    // 提取版本号（到空格、换行、或 HTML 标签结束），Banner 总长仍以 BannerStore 容量为限
+    auto end_pos = response.find_first_of(" \r\n<\"", hit.pos);
+    std::string detected = " (Detected: ";
+    detected.append(response.substr(hit.pos, end_pos - hit.pos));
+    detected += ')';
+    auto& banner = r.attrs.banner;
+    banner.append(detected, 0, BannerStore::kCapacity - std::min(banner.size(), BannerStore::kCapacity));
+}
+
+void HttpProtocol::apply_head(const HttpResponseHead& head, ProtocolAttributes& attrs) {
+    if (head.status != 0) attrs.http.status_code = head.status;
+    if (auto v = head.find("server"); !v.empty()) attrs.http.server = v;
+    if (auto v = head.find("content-type"); !v.empty()) attrs.http.content_type = v;
 }
 
 } // namespace scanner
@@ -1,59 +1,87 @@
 #include "scanner/protocols/imap_protocol.h"
+#include "scanner/protocols/probe_engine.h"
+#include "scanner/protocols/keyword_table.h"
 #include "scanner/common/logger.h"
-#include <boost/asio/write.hpp>
-#include <boost/asio/read_until.hpp>
-#include <boost/asio/streambuf.hpp>
-#include <sstream>
-#include <chrono>
 
 namespace scanner {
 
-namespace asio = boost::asio;
-using tcp = asio::ip::tcp;
-using steady_timer = asio::steady_timer;
+namespace {
+
+using ImapAttrs = decltype(ProtocolAttributes::imap);
+
+// CAPABILITY 原子，下标即能力位；一行列出全部能力，先合成位集再逐位置标志
+constexpr KeywordTable<9> kCapabilityKeywords({
+    "imap4rev1", "starttls", "auth=plain", "auth=login", "idle", "unselect", "uidplus", "quota", "acl",
+});
+
+constexpr bool ImapAttrs::* kCapabilityFlags[] = {
+    &ImapAttrs::imap4rev1, &ImapAttrs::starttls, &ImapAttrs::auth_plain, &ImapAttrs::auth_login,
+    &ImapAttrs::idle, &ImapAttrs::unselect, &ImapAttrs::uidplus, &ImapAttrs::quota, &ImapAttrs::acl,
+};
+
+} // namespace
 
 // =====================
-// IMAP 异步协议实现
+// IMAP 探测步骤
 // =====================
 
-struct ProbeContext {
-    ProtocolResult result;
-    tcp::socket socket;
-    steady_timer timer;
-    asio::streambuf buffer;
-    Timeout timeout;
-    std::function<void(ProtocolResult&&)> on_complete;
-    std::chrono::steady_clock::time_point start_time;
-    std::string tag;
-    bool completed{false};
-
-    ProbeContext(boost::asio::any_io_executor exec, Timeout t, std::function<void(ProtocolResult&&)> cb)
-        : socket(std::move(exec)), timer(socket.get_executor()), timeout(t), on_complete(std::move(cb)),
-          tag("A001") {}
-
-    void finish_success() {
-        result.accessible = true;
-        auto end = std::chrono::steady_clock::now();
-        result.attrs.response_time_ms =
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time).count();
-        complete();
-    }
+class ImapProtocol::Probe : public ProbeEngine<ImapProtocol::Probe> {
+public:
+    Probe(ProbeParams&& params, const ImapProtocol& proto)
+        : ProbeEngine(std::move(params)), proto_(proto) {}
 
-    void finish_error(const std::string& msg) {
-        result.error = msg;
-        complete();
-    }
+private:
+    friend class ProbeEngine<Probe>;
+
+    static constexpr const char* kTag = "A001";
+
+    // 开启抢先发送时 CAPABILITY 在连接后立即写出，不等欢迎消息
+    ProbeTask run() {
+        static const std::string capability_cmd = std::string(kTag) + " CAPABILITY\r\n";
+        const bool early = proto_.optimistic_enabled();
+        if (early) co_await write(capability_cmd, "CAPABILITY");
+
+        auto greeting = co_await read_line("greeting");
+        if (greeting.find("* OK") != 0 && greeting.find("* PREAUTH") != 0) {
+            finish_error("Invalid IMAP greeting: " + std::string(greeting));
+            co_return;
+        }
+        banner().assign(greeting);
+        if (early) {
+            settle();
+        } else {
+            co_await write(capability_cmd, "CAPABILITY");
+        }
+
+        for (;;) {
+            auto line = co_await read_line("capability");
+            if (line.find("* CAPABILITY") == 0) {
+                proto_.parse_capability_line(line, attrs());
+            } else if (line.find(kTag) != std::string_view::npos) {
+                if (line.find("OK") == std::string_view::npos) {
+                    finish_error("CAPABILITY failed: " + std::string(line));
+                    co_return;
+                }
+                break;
+            }
+        }
 
-    void complete() {
-        if (completed) return;
-        completed = true;
-        boost::system::error_code ec;
-        (void)timer.cancel();
-        socket.close(ec);
-        if (on_complete) {
-            on_complete(std::move(result));
+        if (proto_.starttls_enabled() && attrs().imap.starttls && !tls_active()) {
+            static const std::string starttls_cmd = "A002 STARTTLS\r\n";
+            co_await write(starttls_cmd, "STARTTLS");
+            for (;;) {
+                auto line = co_await read_line("STARTTLS");
+                if (line.find("A002") != 0) continue;
+                if (line.find("OK") != std::string_view::npos) {
+                    co_await start_tls();
+                }
+                break;
+            }
         }
+        finish_success();
     }
+
+    const ImapProtocol& proto_;
 };
 
 void ImapProtocol::async_probe(
@@ -64,156 +92,53 @@ void ImapProtocol::async_probe(
     boost::asio::any_io_executor exec,
     std::function<void(ProtocolResult&&)> on_complete
 ) {
-    auto ctx = std::make_shared<ProbeContext>(std::move(exec), timeout, std::move(on_complete));
-    ctx->result.protocol = name();
-    ctx->result.host = target;
-    ctx->result.port = port;
-    ctx->start_time = std::chrono::steady_clock::now();
-
-    // 超时处理
-    ctx->timer.expires_after(timeout);
-    ctx->timer.async_wait([ctx](const boost::system::error_code& ec) {
-        if (!ec) {
-            ctx->finish_error("IMAP probe timed out");
-        }
-    });
-
-    boost::system::error_code ec;
-    auto address = asio::ip::make_address(ip, ec);
-    if (ec) {
-        ctx->finish_error("Invalid address: " + ec.message());
-        return;
-    }
-
-    tcp::endpoint endpoint(address, port);
-    auto read_capability = std::make_shared<std::function<void()>>();
-    auto read_greeting = std::make_shared<std::function<void()>>();
-
-    *read_capability = [ctx, read_capability]() {
-        asio::async_read_until(
-            ctx->socket,
-            ctx->buffer,
-            "\r\n",
-            [ctx, read_capability](const boost::system::error_code& ec, std::size_t /*bytes*/) {
-                if (ec) {
-                    ctx->finish_error("Read capability failed: " + ec.message());
-                    return;
-                }
-
-                std::istream response_stream(&ctx->buffer);
-                std::string line;
-                if (!std::getline(response_stream, line)) {
-                    ctx->finish_error("Capability parsing error");
-                    return;
-                }
-
-                if (!line.empty() && line.back() == '\r') {
-                    line.pop_back();
-                }
-
-                // Parse capabilities
-                if (line.find(ctx->tag) != std::string::npos) {
-                    if (line.find("OK") != std::string::npos) {
-                        ctx->finish_success();
-                        return;
-                    } else {
-                        ctx->finish_error("CAPABILITY failed: " + line);
-                        return;
-                    }
-                }
-
-                (*read_capability)();
-            });
-    };
-
-    *read_greeting = [ctx, read_capability]() {
-        asio::async_read_until(
-            ctx->socket,
-            ctx->buffer,
-            "\r\n",
-            [ctx, read_capability](const boost::system::error_code& ec, std::size_t /*bytes*/) {
-                if (ec) {
-                    ctx->finish_error("Read greeting failed: " + ec.message());
-                    return;
-                }
-
-                std::istream response_stream(&ctx->buffer);
-                std::string line;
-                if (!std::getline(response_stream, line)) {
-                    ctx->finish_error("Greeting parsing error");
-                    return;
-                }
-
-                if (!line.empty() && line.back() == '\r') {
-                    line.pop_back();
-                }
+    ProbeEngine<Probe>::launch(
+        ProbeParams{name(), target, ip, port, timeout, std::move(exec), std::move(on_complete), requires_tls(port),
+                    idle_nudge(port), idle_nudge_payload()},
+        *this);
+}
 
-                if (line.find("* OK") == 0 || line.find("* PREAUTH") == 0) {
-                    ctx->result.attrs.banner = line;
-                    // Send CAPABILITY command
-                    std::string cmd = ctx->tag + " CAPABILITY\r\n";
-                    asio::async_write(
-                        ctx->socket,
-                        asio::buffer(cmd),
-                        [ctx, read_capability](const boost::system::error_code& write_ec, std::size_t /*bytes*/) {
-                            if (write_ec) {
-                                ctx->finish_error("Write CAPABILITY failed: " + write_ec.message());
-                                return;
-                            }
-                            (*read_capability)();
-                        });
-                } else {
-                    ctx->finish_error("Invalid IMAP greeting: " + line);
-                }
-            });
-    };
+int ImapProtocol::match_greeting(std::string_view greeting) const {
+    return (greeting.substr(0, 4) == "* OK" || greeting.substr(0, 9) == "* PREAUTH") ? 2 : 0;
+}
 
-    ctx->socket.async_connect(endpoint, [ctx, read_greeting](const boost::system::error_code& connect_ec) {
-        if (connect_ec) {
-            ctx->finish_error("Connect failed: " + connect_ec.message());
-            return;
-        }
-        ctx->start_time = std::chrono::steady_clock::now();
-        (*read_greeting)();
-    });
+void ImapProtocol::async_probe_connected(
+    ProbeConnection&& conn,
+    const std::string& target,
+    Port port,
+    Timeout timeout,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    auto exec = conn.socket.get_executor();
+    ProbeEngine<Probe>::adopt(
+        ProbeParams{name(), target, {}, port, timeout, std::move(exec), std::move(on_complete)},
+        std::move(conn), *this);
 }
 
 void ImapProtocol::parse_capabilities(
     const std::string& response,
     ProtocolAttributes& attrs
 ) {
-    std::istringstream iss(response);
-    std::string line;
-    while (std::getline(iss, line)) {
+    std::string_view rest = response;
+    std::string_view line;
+    while (next_line(rest, line)) {
         if (line.find("* OK") == 0 || line.find("* PREAUTH") == 0) {
             attrs.banner = line;
             continue;
         }
         if (line.find("* CAPABILITY") == 0) {
-            // Parse capabilities
-            if (line.find("IMAP4rev1") != std::string::npos) {
-                attrs.imap.imap4rev1 = true;
-            }
-            if (line.find("STARTTLS") != std::string::npos) {
-                attrs.imap.starttls = true;
-            }
-            if (line.find("AUTH=PLAIN") != std::string::npos) {
-                attrs.imap.auth_plain = true;
-            }
-            if (line.find("AUTH=LOGIN") != std::string::npos) {
-                attrs.imap.auth_login = true;
-            }
-            if (line.find("IDLE") != std::string::npos) {
-                attrs.imap.idle = true;
-            }
-            if (line.find("UNSELECT") != std::string::npos) {
-                attrs.imap.unselect = true;
-            }
-            if (line.find("UIDPLUS") != std::string::npos) {
-                attrs.imap.uidplus = true;
-            }
+            parse_capability_line(line, attrs);
         }
     }
 }
 
+void ImapProtocol::parse_capability_line(
+    std::string_view line,
+    ProtocolAttributes& attrs
+) const {
+    for (uint32_t bits = kCapabilityKeywords.match_all(line); bits; bits &= bits - 1) {
+        attrs.imap.*kCapabilityFlags[__builtin_ctz(bits)] = true;
+    }
+}
+
 } // namespace scanner
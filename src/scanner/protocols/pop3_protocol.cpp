@@ -1,57 +1,75 @@
 #include "scanner/protocols/pop3_protocol.h"
+#include "scanner/protocols/probe_engine.h"
+#include "scanner/protocols/keyword_table.h"
 #include "scanner/common/logger.h"
-#include <boost/asio/write.hpp>
-#include <boost/asio/read_until.hpp>
-#include <boost/asio/streambuf.hpp>
-#include <sstream>
-#include <chrono>
 
 namespace scanner {
 
-namespace asio = boost::asio;
-using tcp = asio::ip::tcp;
-using steady_timer = asio::steady_timer;
+namespace {
 
-// =====================
-// POP3 异步协议实现
-// =====================
+using Pop3Attrs = decltype(ProtocolAttributes::pop3);
 
-struct ProbeContext {
-    ProtocolResult result;
-    tcp::socket socket;
-    steady_timer timer;
-    asio::streambuf buffer;
-    Timeout timeout;
-    std::function<void(ProtocolResult&&)> on_complete;
-    std::chrono::steady_clock::time_point start_time;
-    bool completed{false};
-
-    ProbeContext(boost::asio::any_io_executor exec, Timeout t, std::function<void(ProtocolResult&&)> cb)
-        : socket(std::move(exec)), timer(socket.get_executor()), timeout(t), on_complete(std::move(cb)) {}
-
-    void finish_success() {
-        result.accessible = true;
-        auto end = std::chrono::steady_clock::now();
-        result.attrs.response_time_ms =
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time).count();
-        complete();
-    }
+// CAPA 标签，下标即能力位；每行只有行首一个标签，其后是参数（如 "SASL PLAIN LOGIN"）
+constexpr KeywordTable<6> kCapaKeywords({
+    "user", "top", "pipelining", "uidl", "stls", "sasl",
+});
 
-    void finish_error(const std::string& msg) {
-        result.error = msg;
-        complete();
-    }
+constexpr bool Pop3Attrs::* kCapaFlags[] = {
+    &Pop3Attrs::user, &Pop3Attrs::top, &Pop3Attrs::pipelining, &Pop3Attrs::uidl, &Pop3Attrs::stls, &Pop3Attrs::sasl,
+};
 
-    void complete() {
-        if (completed) return;
-        completed = true;
-        boost::system::error_code ec;
-        (void)timer.cancel();
-        socket.close(ec);
-        if (on_complete) {
-            on_complete(std::move(result));
+} // namespace
+
+// =====================
+// POP3 探测步骤
+// =====================
+
+class Pop3Protocol::Probe : public ProbeEngine<Pop3Protocol::Probe> {
+public:
+    Probe(ProbeParams&& params, const Pop3Protocol& proto)
+        : ProbeEngine(std::move(params)), proto_(proto) {}
+
+private:
+    friend class ProbeEngine<Probe>;
+
+    // 默认只在需要 STLS 时多问一次 CAPA；开启抢先发送时连接后立即写出 CAPA，
+    // 欢迎消息与 CAPA 应答通常同批到达，一次往返拿到两者
+    ProbeTask run() {
+        static const std::string capa_cmd = "CAPA\r\n";
+        const bool early = proto_.optimistic_enabled();
+        if (early) co_await write(capa_cmd, "CAPA");
+
+        auto line = co_await read_line("greeting");
+        if (line.find("OK") == std::string_view::npos && line.find("+OK") != 0) {
+            finish_error("Invalid POP3 greeting: " + std::string(line));
+            co_return;
+        }
+        banner().assign(line);
+        if (early) settle();
+
+        if (early || (proto_.starttls_enabled() && !tls_active())) {
+            if (!early) co_await write(capa_cmd, "CAPA");
+            auto status = co_await read_line("CAPA");
+            if (status.find("+OK") == 0) {
+                for (;;) {
+                    auto cap = co_await read_line("CAPA");
+                    if (cap == ".") break;
+                    proto_.parse_capa_line(cap, attrs());
+                }
+            }
+        }
+        if (proto_.starttls_enabled() && attrs().pop3.stls && !tls_active()) {
+            static const std::string stls_cmd = "STLS\r\n";
+            co_await write(stls_cmd, "STLS");
+            auto reply = co_await read_line("STLS");
+            if (reply.find("+OK") == 0) {
+                co_await start_tls();
+            }
         }
+        finish_success();
     }
+
+    const Pop3Protocol& proto_;
 };
 
 void Pop3Protocol::async_probe(
@@ -62,94 +80,55 @@ void Pop3Protocol::async_probe(
     boost::asio::any_io_executor exec,
     std::function<void(ProtocolResult&&)> on_complete
 ) {
-    auto ctx = std::make_shared<ProbeContext>(std::move(exec), timeout, std::move(on_complete));
-    ctx->result.protocol = name();
-    ctx->result.host = target;
-    ctx->result.port = port;
-    ctx->start_time = std::chrono::steady_clock::now();
-
-    // 超时处理
-    ctx->timer.expires_after(timeout);
-    ctx->timer.async_wait([ctx](const boost::system::error_code& ec) {
-        if (!ec) {
-            ctx->finish_error("POP3 probe timed out");
-        }
-    });
-
-    boost::system::error_code ec;
-    auto address = asio::ip::make_address(ip, ec);
-    if (ec) {
-        ctx->finish_error("Invalid address: " + ec.message());
-        return;
-    }
-
-    tcp::endpoint endpoint(address, port);
-    auto read_greeting = std::make_shared<std::function<void()>>();
-
-    *read_greeting = [ctx]() {
-        asio::async_read_until(
-            ctx->socket,
-            ctx->buffer,
-            "\r\n",
-            [ctx](const boost::system::error_code& ec, std::size_t /*bytes*/) {
-                if (ec) {
-                    ctx->finish_error("Read greeting failed: " + ec.message());
-                    return;
-                }
-
-                std::istream response_stream(&ctx->buffer);
-                std::string line;
-                if (!std::getline(response_stream, line)) {
-                    ctx->finish_error("Greeting parsing error");
-                    return;
-                }
+    ProbeEngine<Probe>::launch(
+        ProbeParams{name(), target, ip, port, timeout, std::move(exec), std::move(on_complete), requires_tls(port),
+                    idle_nudge(port), idle_nudge_payload()},
+        *this);
+}
 
-                if (line.find("OK") != std::string::npos || line.find("+OK") == 0) {
-                    ctx->result.attrs.banner = line;
-                    ctx->finish_success();
-                } else {
-                    ctx->finish_error("Invalid POP3 greeting: " + line);
-                }
-            });
-    };
+int Pop3Protocol::match_greeting(std::string_view greeting) const {
+    return greeting.substr(0, 3) == "+OK" ? 2 : 0;
+}
 
-    ctx->socket.async_connect(endpoint, [ctx, read_greeting](const boost::system::error_code& connect_ec) {
-        if (connect_ec) {
-            ctx->finish_error("Connect failed: " + connect_ec.message());
-            return;
-        }
-        ctx->start_time = std::chrono::steady_clock::now();
-        (*read_greeting)();
-    });
+void Pop3Protocol::async_probe_connected(
+    ProbeConnection&& conn,
+    const std::string& target,
+    Port port,
+    Timeout timeout,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    auto exec = conn.socket.get_executor();
+    ProbeEngine<Probe>::adopt(
+        ProbeParams{name(), target, {}, port, timeout, std::move(exec), std::move(on_complete)},
+        std::move(conn), *this);
 }
 
 void Pop3Protocol::parse_capabilities(
     const std::string& response,
     ProtocolAttributes& attrs
 ) {
-    std::istringstream iss(response);
-    std::string line;
-    while (std::getline(iss, line)) {
+    std::string_view rest = response;
+    std::string_view line;
+    while (next_line(rest, line)) {
         if (line.find("+OK") == 0) {
             attrs.banner = line;
             continue;
         }
-        // Parse POP3 capabilities if needed
-        if (line.find("USER") != std::string::npos) {
-            attrs.pop3.user = true;
-        }
-        if (line.find("TOP") != std::string::npos) {
-            attrs.pop3.top = true;
-        }
-        if (line.find("PIPELINING") != std::string::npos) {
-            attrs.pop3.pipelining = true;
-        }
-        if (line.find("UIDL") != std::string::npos) {
-            attrs.pop3.uidl = true;
-        }
-        if (line.find("STLS") != std::string::npos) {
-            attrs.pop3.stls = true;
-        }
+        parse_capa_line(line, attrs);
+    }
+}
+
+void Pop3Protocol::parse_capa_line(
+    std::string_view line,
+    ProtocolAttributes& attrs
+) const {
+    std::size_t k = kCapaKeywords.find(split_keyword(line).first);
+    if (k != kCapaKeywords.npos) {
+        attrs.pop3.*kCapaFlags[k] = true;
+    }
+    if (!line.empty()) {
+        if (!attrs.pop3.capabilities.empty()) attrs.pop3.capabilities += ' ';
+        attrs.pop3.capabilities += line;
     }
 }
 
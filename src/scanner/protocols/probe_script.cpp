@@ -0,0 +1,238 @@
+#include "scanner/protocols/probe_script.h"
+#include "scanner/protocols/recv_buffer.h"
+#include "scanner/common/logger.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace scanner {
+
+namespace {
+
+// 反转义 "\xHH"、"\r"、"\n"、"\t"、"\0"、"\\"；其余字符原样保留
+std::string unescape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\' || i + 1 == s.size()) {
+            out += s[i];
+            continue;
+        }
+        char c = s[++i];
+        switch (c) {
+            case 'r': out += '\r'; break;
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case '0': out += '\0'; break;
+            case '\\': out += '\\'; break;
+            case 'x':
+                if (i + 2 < s.size() && std::isxdigit(static_cast<unsigned char>(s[i + 1])) &&
+                    std::isxdigit(static_cast<unsigned char>(s[i + 2]))) {
+                    out += static_cast<char>(std::stoi(s.substr(i + 1, 2), nullptr, 16));
+                    i += 2;
+                    break;
+                }
+                throw std::invalid_argument("bad \\x escape");
+            default:
+                out += '\\';
+                out += c;
+        }
+    }
+    return out;
+}
+
+class Compiler {
+public:
+    explicit Compiler(ProbeProgram& program) : program_(program) {}
+
+    void compile(const nlohmann::json& def) {
+        program_.name = def.at("name").get<std::string>();
+        if (program_.name.empty()) throw std::invalid_argument("empty name");
+        program_.enabled = def.value("enabled", false);
+        program_.ports = def.at("ports").get<std::vector<Port>>();
+        if (program_.ports.empty()) throw std::invalid_argument("no ports");
+        program_.tls_ports = def.value("tls_ports", std::vector<Port>{});
+        program_.timeout = Timeout(def.value("timeout_ms", 3000));
+
+        const auto& steps = def.at("steps");
+        if (!steps.is_array() || steps.empty()) throw std::invalid_argument("no steps");
+        for (std::size_t i = 0; i < steps.size(); ++i) {
+            try {
+                step(steps[i]);
+            } catch (const std::exception& e) {
+                throw std::invalid_argument("step " + std::to_string(i + 1) + ": " + e.what());
+            }
+        }
+
+        // 首步读、次步 expect：服务端先发言，可用该 expect 给欢迎消息打分
+        const auto& code = program_.code;
+        if (code.size() >= 2 && is_read(code[0].op) && is_expect(code[1].op)) {
+            program_.greeting_check = 1;
+        }
+    }
+
+private:
+    static bool is_read(ProbeOp op) {
+        return op >= ProbeOp::ReadLine && op <= ProbeOp::ReadExact;
+    }
+    static bool is_expect(ProbeOp op) {
+        return op >= ProbeOp::ExpectPrefix && op <= ProbeOp::ExpectRegex;
+    }
+
+    void step(const nlohmann::json& s) {
+        if (s.contains("send")) {
+            emit(ProbeOp::Send, constant(unescape(s["send"].get<std::string>())));
+        } else if (s.contains("read")) {
+            read(s);
+        } else if (s.contains("expect")) {
+            expect(s);
+        } else if (s.contains("extract")) {
+            auto field = index(program_.fields, s["extract"].get<std::string>());
+            auto re = pattern(s.at("regex").get<std::string>());
+            if (re_groups_.back() < 1) throw std::invalid_argument("extract regex needs a capture group");
+            emit(ProbeOp::Extract, re, field);
+        } else if (s.contains("banner")) {
+            emit(ProbeOp::Banner);
+        } else if (s.contains("settle")) {
+            emit(ProbeOp::Settle);
+        } else {
+            throw std::invalid_argument("unknown step " + s.dump());
+        }
+    }
+
+    void read(const nlohmann::json& s) {
+        auto mode = s["read"].get<std::string>();
+        if (mode == "line") {
+            emit(ProbeOp::ReadLine);
+        } else if (mode == "reply") {
+            emit(ProbeOp::ReadReply);
+        } else if (mode == "some") {
+            emit(ProbeOp::ReadSome, 0, RecvBuffer::kCapacity);
+        } else if (mode == "until") {
+            auto delim = unescape(s.at("delim").get<std::string>());
+            if (delim.empty()) throw std::invalid_argument("empty delim");
+            emit(ProbeOp::ReadUntil, constant(std::move(delim)));
+        } else if (mode == "exact") {
+            auto n = s.at("bytes").get<std::size_t>();
+            if (n == 0 || n > RecvBuffer::kCapacity) {
+                throw std::invalid_argument("bytes must be 1.." + std::to_string(RecvBuffer::kCapacity));
+            }
+            emit(ProbeOp::ReadExact, 0, static_cast<uint32_t>(n));
+        } else {
+            throw std::invalid_argument("unknown read mode '" + mode + "'");
+        }
+        has_read_ = true;
+    }
+
+    void expect(const nlohmann::json& s) {
+        if (!has_read_) throw std::invalid_argument("expect before any read");
+        const auto& e = s["expect"];
+        ProbeMiss miss = ProbeMiss::Fail;
+        auto on_miss = s.value("else", std::string("fail"));
+        if (on_miss == "done") {
+            miss = ProbeMiss::Done;
+        } else if (on_miss != "fail") {
+            throw std::invalid_argument("else must be 'fail' or 'done'");
+        }
+        if (e.contains("prefix")) {
+            emit(ProbeOp::ExpectPrefix, constant(unescape(e["prefix"].get<std::string>())), 0, miss);
+        } else if (e.contains("contains")) {
+            emit(ProbeOp::ExpectContains, constant(unescape(e["contains"].get<std::string>())), 0, miss);
+        } else if (e.contains("regex")) {
+            emit(ProbeOp::ExpectRegex, pattern(e["regex"].get<std::string>()), 0, miss);
+        } else {
+            throw std::invalid_argument("expect needs prefix, contains or regex");
+        }
+    }
+
+    void emit(ProbeOp op, uint16_t arg = 0, uint32_t len = 0, ProbeMiss miss = ProbeMiss::Fail) {
+        program_.code.push_back(ProbeInstr{op, miss, arg, len});
+    }
+
+    uint16_t constant(std::string value) {
+        return index(program_.constants, std::move(value));
+    }
+
+    uint16_t pattern(const std::string& re) {
+        check_room(program_.patterns.size());
+        program_.patterns.emplace_back(re, std::regex::ECMAScript | std::regex::optimize);
+        re_groups_.push_back(program_.patterns.back().mark_count());
+        return static_cast<uint16_t>(program_.patterns.size() - 1);
+    }
+
+    // 相同字符串只存一份
+    static uint16_t index(std::vector<std::string>& pool, std::string value) {
+        auto it = std::find(pool.begin(), pool.end(), value);
+        if (it != pool.end()) return static_cast<uint16_t>(it - pool.begin());
+        check_room(pool.size());
+        pool.push_back(std::move(value));
+        return static_cast<uint16_t>(pool.size() - 1);
+    }
+
+    static void check_room(std::size_t size) {
+        if (size >= std::numeric_limits<uint16_t>::max()) throw std::invalid_argument("too many constants");
+    }
+
+    ProbeProgram& program_;
+    std::vector<unsigned> re_groups_;
+    bool has_read_ = false;
+};
+
+} // namespace
+
+bool ProbeProgram::matches(const ProbeInstr& in, std::string_view data) const {
+    switch (in.op) {
+        case ProbeOp::ExpectPrefix:
+            return data.substr(0, constants[in.arg].size()) == constants[in.arg];
+        case ProbeOp::ExpectContains:
+            return data.find(constants[in.arg]) != std::string_view::npos;
+        case ProbeOp::ExpectRegex:
+            return std::regex_search(data.begin(), data.end(), patterns[in.arg]);
+        default:
+            return false;
+    }
+}
+
+std::vector<std::shared_ptr<const ProbeProgram>> load_probe_definitions(const std::string& path) {
+    std::vector<std::shared_ptr<const ProbeProgram>> programs;
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        LOG_CORE_DEBUG("No probe definition file at {}", path);
+        return programs;
+    }
+
+    nlohmann::json j;
+    try {
+        j = nlohmann::json::parse(ifs);
+    } catch (const nlohmann::json::exception& e) {
+        LOG_CORE_ERROR("Failed to parse probe definition file '{}': {}", path, e.what());
+        return programs;
+    }
+    if (!j.contains("probes") || !j["probes"].is_array()) {
+        LOG_CORE_ERROR("Invalid probe definition file '{}': missing 'probes' array", path);
+        return programs;
+    }
+
+    for (std::size_t i = 0; i < j["probes"].size(); ++i) {
+        const auto& def = j["probes"][i];
+        auto program = std::make_shared<ProbeProgram>();
+        try {
+            Compiler(*program).compile(def);
+        } catch (const std::exception& e) {
+            LOG_CORE_ERROR("Skipping probe definition #{} ({}) in {}: {}",
+                           i + 1, def.value("name", std::string("?")), path, e.what());
+            continue;
+        }
+        LOG_CORE_DEBUG("Compiled probe {}: {} instructions, {} constants, {} patterns",
+                       program->name, program->code.size(), program->constants.size(),
+                       program->patterns.size());
+        programs.push_back(std::move(program));
+    }
+    LOG_CORE_INFO("Loaded {} probe definitions from {}", programs.size(), path);
+    return programs;
+}
+
+} // namespace scanner
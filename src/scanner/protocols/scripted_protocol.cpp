@@ -0,0 +1,124 @@
+#include "scanner/protocols/scripted_protocol.h"
+#include "scanner/protocols/probe_engine.h"
+#include "scanner/common/logger.h"
+
+namespace scanner {
+
+// =====================
+// 字节码解释器
+// =====================
+// 顺序执行 ProbeProgram::code。读指令把结果留在 data 中（指向接收缓冲的视图，
+// 在下一条读指令之前有效），expect / extract / banner 都作用于它。
+
+class ScriptedProtocol::Probe : public ProbeEngine<ScriptedProtocol::Probe> {
+public:
+    Probe(ProbeParams&& params, const ScriptedProtocol& proto)
+        : ProbeEngine(std::move(params)), program_(*proto.program_) {}
+
+private:
+    friend class ProbeEngine<Probe>;
+
+    ProbeTask run() {
+        std::string_view data;
+        for (std::size_t pc = 0; pc < program_.code.size(); ++pc) {
+            const ProbeInstr& in = program_.code[pc];
+            switch (in.op) {
+                case ProbeOp::Send:
+                    co_await write(program_.constants[in.arg], "send");
+                    break;
+                case ProbeOp::ReadLine:
+                    data = co_await read_line("read");
+                    break;
+                case ProbeOp::ReadReply:
+                    data = co_await read_reply("read");
+                    break;
+                case ProbeOp::ReadUntil:
+                    data = co_await read_until(program_.constants[in.arg], "read");
+                    break;
+                case ProbeOp::ReadSome:
+                    data = co_await read_some(in.len, "read");
+                    break;
+                case ProbeOp::ReadExact:
+                    data = co_await read_exact(in.len, "read");
+                    break;
+                case ProbeOp::ExpectPrefix:
+                case ProbeOp::ExpectContains:
+                case ProbeOp::ExpectRegex:
+                    if (!program_.matches(in, data)) {
+                        if (in.miss == ProbeMiss::Done) {
+                            finish_success();
+                        } else {
+                            finish_error("Unexpected response at step " + std::to_string(pc + 1));
+                        }
+                        co_return;
+                    }
+                    break;
+                case ProbeOp::Extract: {
+                    std::match_results<std::string_view::const_iterator> m;
+                    if (std::regex_search(data.begin(), data.end(), m, program_.patterns[in.arg]) &&
+                        m[1].matched) {
+                        attrs().fields.emplace_back(program_.fields[in.len], m[1].str());
+                    }
+                    break;
+                }
+                case ProbeOp::Banner:
+                    set_banner(data);
+                    break;
+                case ProbeOp::Settle:
+                    settle();
+                    break;
+            }
+        }
+        finish_success();
+    }
+
+    // 首个非空行中的可打印字符
+    void set_banner(std::string_view data) {
+        std::string_view line;
+        while (next_line(data, line) && line.empty()) {}
+        char printable[BannerStore::kCapacity];
+        std::size_t n = 0;
+        for (char c : line) {
+            if (n == sizeof(printable)) break;
+            if (c >= 0x20 && c < 0x7f) printable[n++] = c;
+        }
+        banner().assign(std::string_view(printable, n));
+    }
+
+    const ProbeProgram& program_;
+};
+
+void ScriptedProtocol::async_probe(
+    const std::string& target,
+    const std::string& ip,
+    Port port,
+    Timeout timeout,
+    boost::asio::any_io_executor exec,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    ProbeEngine<Probe>::launch(
+        ProbeParams{name(), target, ip, port, timeout, std::move(exec), std::move(on_complete), requires_tls(port),
+                    idle_nudge(port), idle_nudge_payload()},
+        *this);
+}
+
+// 用定义中紧跟首次读取的 expect 给欢迎消息打分
+int ScriptedProtocol::match_greeting(std::string_view greeting) const {
+    if (!program_->server_first()) return 0;
+    return program_->matches(program_->code[program_->greeting_check], greeting) ? 2 : 0;
+}
+
+void ScriptedProtocol::async_probe_connected(
+    ProbeConnection&& conn,
+    const std::string& target,
+    Port port,
+    Timeout timeout,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    auto exec = conn.socket.get_executor();
+    ProbeEngine<Probe>::adopt(
+        ProbeParams{name(), target, {}, port, timeout, std::move(exec), std::move(on_complete)},
+        std::move(conn), *this);
+}
+
+} // namespace scanner
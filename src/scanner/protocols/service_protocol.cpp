@@ -0,0 +1,143 @@
+#include "scanner/protocols/service_protocol.h"
+#include "scanner/protocols/probe_engine.h"
+#include "scanner/common/logger.h"
+#include <algorithm>
+#include <optional>
+
+namespace scanner {
+
+namespace {
+
+// 首段应答之后再等这么久收集后续数据（应答分多段到达、首段不足以匹配时）
+constexpr Timeout kTrailingDataWait{500};
+
+} // namespace
+
+// =====================
+// 单个探测
+// =====================
+// 发送载荷（NULL 探测不发），读应答并匹配；未得到 match 时在 kTrailingDataWait 内继续收数据再匹配。
+// 收到首段应答后即 settle()：之后超时或对端关闭都按成功收尾，带上已有的匹配结果。
+
+class ServiceProtocol::Probe : public ProbeEngine<ServiceProtocol::Probe> {
+public:
+    Probe(ProbeParams&& params, const ServiceProbe& probe, const ServiceProbeDb& db)
+        : ProbeEngine(std::move(params)), probe_(probe), db_(db) {}
+
+private:
+    friend class ProbeEngine<Probe>;
+
+    ProbeTask run() {
+        if (!probe_.payload.empty()) {
+            co_await write(probe_.payload, "probe");
+        }
+        while (response_.size() < RecvBuffer::kCapacity) {
+            auto data = co_await read_some(RecvBuffer::kCapacity - response_.size(), "response");
+            if (response_.empty()) {
+                settle();
+                tighten_deadline(kTrailingDataWait);
+            }
+            response_.append(data);
+            set_banner();
+            if (db_.match(probe_, response_, attrs()) && !attrs().service.soft) break;
+        }
+        finish_success();
+    }
+
+    // 首个非空行中的可打印字符
+    void set_banner() {
+        std::string_view rest(response_), line;
+        while (next_line(rest, line) && line.empty()) {}
+        char printable[BannerStore::kCapacity];
+        std::size_t n = 0;
+        for (char c : line) {
+            if (n == sizeof(printable)) break;
+            if (c >= 0x20 && c < 0x7f) printable[n++] = c;
+        }
+        banner().assign(std::string_view(printable, n));
+    }
+
+    const ServiceProbe& probe_;
+    const ServiceProbeDb& db_;
+    std::string response_;
+};
+
+// =====================
+// 探测链
+// =====================
+// 依次运行选出的探测；Chain 由各探测的回调持有，最后一个探测结束后释放。
+
+class ServiceProtocol::Chain : public std::enable_shared_from_this<ServiceProtocol::Chain> {
+public:
+    Chain(const ServiceProtocol& proto, std::vector<const ServiceProbe*> probes, const std::string& target,
+          const std::string& ip, Port port, Timeout timeout, boost::asio::any_io_executor exec,
+          std::function<void(ProtocolResult&&)> on_complete)
+        : db_(proto.db_), probes_(std::move(probes)), target_(target), ip_(ip), port_(port),
+          timeout_(timeout), tls_(proto.requires_tls(port)), exec_(std::move(exec)),
+          on_complete_(std::move(on_complete)) {}
+
+    void next() {
+        const ServiceProbe* probe = probes_[index_++];
+        ProbeEngine<Probe>::launch(
+            ProbeParams{"SERVICE", target_, ip_, port_, std::min(timeout_, probe->total_wait), exec_,
+                        [self = shared_from_this()](ProtocolResult&& r) { self->done(std::move(r)); }, tls_},
+            *probe, *db_);
+    }
+
+private:
+    // softmatch > 有应答 > 仅连接成功 > 错误
+    static int rank(const ProtocolResult& r) {
+        if (!r.attrs.service.name.empty()) return 3;
+        if (!r.attrs.banner.empty()) return 2;
+        return r.accessible ? 1 : 0;
+    }
+
+    void done(ProtocolResult&& r) {
+        bool hard = !r.attrs.service.name.empty() && !r.attrs.service.soft;
+        bool unreachable = r.error.rfind("Connect failed", 0) == 0 || r.error.rfind("Invalid address", 0) == 0;
+        if (!best_ || rank(r) > rank(*best_)) best_ = std::move(r);
+        if (hard || unreachable || index_ == probes_.size()) {
+            on_complete_(std::move(*best_));
+            return;
+        }
+        next();
+    }
+
+    std::shared_ptr<const ServiceProbeDb> db_;
+    std::vector<const ServiceProbe*> probes_;
+    std::size_t index_ = 0;
+    std::string target_;
+    std::string ip_;
+    Port port_;
+    Timeout timeout_;
+    bool tls_;
+    boost::asio::any_io_executor exec_;
+    std::function<void(ProtocolResult&&)> on_complete_;
+    std::optional<ProtocolResult> best_;
+};
+
+void ServiceProtocol::async_probe(
+    const std::string& target,
+    const std::string& ip,
+    Port port,
+    Timeout timeout,
+    boost::asio::any_io_executor exec,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    auto probes = db_->probes_for(port, requires_tls(port), intensity_, max_probes_);
+    if (probes.empty()) {
+        ProtocolResult r;
+        r.protocol = name();
+        r.host = target;
+        r.port = port;
+        r.error = "No service probe for port " + std::to_string(port);
+        boost::asio::post(exec, [r = std::move(r), on_complete = std::move(on_complete)]() mutable {
+            on_complete(std::move(r));
+        });
+        return;
+    }
+    std::make_shared<Chain>(*this, std::move(probes), target, ip, port, timeout, std::move(exec),
+                            std::move(on_complete))->next();
+}
+
+} // namespace scanner
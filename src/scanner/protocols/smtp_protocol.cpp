@@ -1,60 +1,80 @@
 #include "scanner/protocols/smtp_protocol.h"
+#include "scanner/protocols/probe_engine.h"
+#include "scanner/protocols/keyword_table.h"
 #include "scanner/common/logger.h"
-#include <boost/asio/write.hpp>
-#include <boost/asio/read_until.hpp>
-#include <boost/asio/streambuf.hpp>
-#include <sstream>
-#include <chrono>
 
 namespace scanner {
 
-namespace asio = boost::asio;
-using tcp = asio::ip::tcp;
-using steady_timer = asio::steady_timer;
+namespace {
+
+using SmtpAttrs = decltype(ProtocolAttributes::smtp);
+
+// EHLO 关键字，下标即能力位；前 kEhloFlags 个只置位，SIZE / AUTH 还要解析参数
+enum EhloKeyword : std::size_t { kPipelining, kStarttls, k8bitmime, kDsn, kSmtputf8, kSize, kAuth };
+
+constexpr KeywordTable<7> kEhloKeywords({
+    "pipelining", "starttls", "8bitmime", "dsn", "smtputf8", "size", "auth",
+});
+
+constexpr bool SmtpAttrs::* kEhloFlags[] = {
+    &SmtpAttrs::pipelining, &SmtpAttrs::starttls, &SmtpAttrs::_8bitmime, &SmtpAttrs::dsn, &SmtpAttrs::utf8,
+};
+
+} // namespace
 
 // =====================
-// SMTP 异步协议实现
+// SMTP 探测步骤
 // =====================
 
-// namespace {
-struct ProbeContext {
-    ProtocolResult result;
-    tcp::socket socket;
-    steady_timer timer;
-    asio::streambuf buffer;
-    Timeout timeout;
-    std::function<void(ProtocolResult&&)> on_complete;
-    std::chrono::steady_clock::time_point start_time;
-    bool completed{false};
-
-    ProbeContext(boost::asio::any_io_executor exec, Timeout t, std::function<void(ProtocolResult&&)> cb)
-        : socket(std::move(exec)), timer(socket.get_executor()), timeout(t), on_complete(std::move(cb)) {}
-
-    void finish_success() {
-        result.accessible = true;
-        auto end = std::chrono::steady_clock::now();
-        result.attrs.response_time_ms =
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time).count();
-        complete();
-    }
+class SmtpProtocol::Probe : public ProbeEngine<SmtpProtocol::Probe> {
+public:
+    Probe(ProbeParams&& params, const SmtpProtocol& proto)
+        : ProbeEngine(std::move(params)), proto_(proto) {}
+
+private:
+    friend class ProbeEngine<Probe>;
+
+    // 欢迎语与 EHLO 应答都按整块读取：缓冲中已有的行一次解析完，
+    // 只有结束行（"220 " / "250 "）尚未到达时才回到 socket。
+    // 开启抢先发送时 EHLO 在连接后立即写出，两段应答往往同批到达。
+    ProbeTask run() {
+        static const std::string ehlo_cmd = "EHLO scanner\r\n";
+        const bool early = proto_.optimistic_enabled();
+        if (early) co_await write(ehlo_cmd, "EHLO");
+
+        auto welcome = co_await read_reply("banner");
+        std::string_view first;
+        next_line(welcome, first);
+        if (first.find("220") != 0) {
+            finish_error("Invalid welcome: " + std::string(first));
+            co_return;
+        }
+        banner().assign(first);
+        if (early) {
+            settle();
+        } else {
+            co_await write(ehlo_cmd, "EHLO");
+        }
 
-    void finish_error(const std::string& msg) {
-        result.error = msg;
-        complete();
-    }
+        auto ehlo = co_await read_reply("EHLO");
+        std::string_view line;
+        while (next_line(ehlo, line)) {
+            proto_.parse_ehlo_line(line, attrs());
+        }
 
-    void complete() {
-        if (completed) return;
-        completed = true;
-        boost::system::error_code ec;
-        (void)timer.cancel();
-        socket.close(ec);
-        if (on_complete) {
-            on_complete(std::move(result));
+        if (proto_.starttls_enabled() && attrs().smtp.starttls && !tls_active()) {
+            static const std::string starttls_cmd = "STARTTLS\r\n";
+            co_await write(starttls_cmd, "STARTTLS");
+            auto reply = co_await read_reply("STARTTLS");
+            if (reply.substr(0, 3) == "220") {
+                co_await start_tls();
+            }
         }
+        finish_success();
     }
+
+    const SmtpProtocol& proto_;
 };
-// } // namespace
 
 void SmtpProtocol::async_probe(
     const std::string& target,
@@ -64,116 +84,39 @@ void SmtpProtocol::async_probe(
     boost::asio::any_io_executor exec,
     std::function<void(ProtocolResult&&)> on_complete
 ) {
-    auto ctx = std::make_shared<ProbeContext>(std::move(exec), timeout, std::move(on_complete));
-    ctx->result.protocol = name();
-    ctx->result.host = target;
-    ctx->result.port = port;
-    ctx->start_time = std::chrono::steady_clock::now();
-
-    // 超时处理
-    ctx->timer.expires_after(timeout);
-    ctx->timer.async_wait([ctx](const boost::system::error_code& ec) {
-        if (!ec) {
-            ctx->finish_error("SMTP probe timed out");
-        }
-    });
+    ProbeEngine<Probe>::launch(
+        ProbeParams{name(), target, ip, port, timeout, std::move(exec), std::move(on_complete), requires_tls(port),
+                    idle_nudge(port), idle_nudge_payload()},
+        *this);
+}
 
-    boost::system::error_code ec;
-    auto address = asio::ip::make_address(ip, ec);
-    if (ec) {
-        ctx->finish_error("Invalid address: " + ec.message());
-        return;
-    }
+// "220" 同时是 FTP 的欢迎码，首行提到 SMTP / ESMTP 才算明确匹配
+int SmtpProtocol::match_greeting(std::string_view greeting) const {
+    std::string_view line;
+    if (!next_line(greeting, line) || line.substr(0, 3) != "220") return 0;
+    return find_ignore_case(line, "smtp") != std::string_view::npos ? 2 : 1;
+}
 
-    tcp::endpoint endpoint(address, port);
-    auto read_ehlo = std::make_shared<std::function<void()>>();
-    auto read_banner = std::make_shared<std::function<void()>>();
-
-    *read_ehlo = [this, ctx, read_ehlo]() {
-        asio::async_read_until(
-            ctx->socket,
-            ctx->buffer,
-            "\r\n",
-            [this, ctx, read_ehlo](const boost::system::error_code& ec, std::size_t /*bytes*/) {
-                if (ec) {
-                    ctx->finish_error("Read EHLO failed: " + ec.message());
-                    return;
-                }
-
-                std::istream response_stream(&ctx->buffer);
-                std::string line;
-                if (!std::getline(response_stream, line)) {
-                    ctx->finish_error("EHLO parsing error");
-                    return;
-                }
-
-                if (!line.empty() && line.back() == '\r') {
-                    line.pop_back();
-                }
-
-                parse_ehlo_line(line, ctx->result.attrs);
-
-                if (line.find("250 ") == 0) {
-                    ctx->finish_success();
-                    return;
-                }
-
-                (*read_ehlo)();
-            });
-    };
-
-    *read_banner = [ctx, read_ehlo]() {
-        asio::async_read_until(
-            ctx->socket,
-            ctx->buffer,
-            "\r\n",
-            [ctx, read_ehlo](const boost::system::error_code& ec, std::size_t /*bytes*/) {
-                if (ec) {
-                    ctx->finish_error("Read banner failed: " + ec.message());
-                    return;
-                }
-
-                std::istream response_stream(&ctx->buffer);
-                std::string welcome;
-                std::getline(response_stream, welcome);
-
-                if (welcome.find("220") != 0) {
-                    ctx->finish_error("Invalid welcome: " + welcome);
-                    return;
-                }
-
-                ctx->result.attrs.banner = welcome;
-                static const std::string ehlo_cmd = "EHLO scanner\r\n";
-                asio::async_write(
-                    ctx->socket,
-                    asio::buffer(ehlo_cmd),
-                    [ctx, read_ehlo](const boost::system::error_code& write_ec, std::size_t /*bytes*/) {
-                        if (write_ec) {
-                            ctx->finish_error("Write EHLO failed: " + write_ec.message());
-                            return;
-                        }
-                        (*read_ehlo)();
-                    });
-            });
-    };
-
-    ctx->socket.async_connect(endpoint, [ctx, read_banner](const boost::system::error_code& connect_ec) {
-        if (connect_ec) {
-            ctx->finish_error("Connect failed: " + connect_ec.message());
-            return;
-        }
-        ctx->start_time = std::chrono::steady_clock::now();
-        (*read_banner)();
-    });
+void SmtpProtocol::async_probe_connected(
+    ProbeConnection&& conn,
+    const std::string& target,
+    Port port,
+    Timeout timeout,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    auto exec = conn.socket.get_executor();
+    ProbeEngine<Probe>::adopt(
+        ProbeParams{name(), target, {}, port, timeout, std::move(exec), std::move(on_complete)},
+        std::move(conn), *this);
 }
 
 void SmtpProtocol::parse_capabilities(
     const std::string& response,
     ProtocolAttributes& attrs
 ) {
-    std::istringstream iss(response);
-    std::string line;
-    while (std::getline(iss, line)) {
+    std::string_view rest = response;
+    std::string_view line;
+    while (next_line(rest, line)) {
         if (line.find("220") == 0) {
             attrs.banner = line;
             continue;
@@ -185,10 +128,10 @@ void SmtpProtocol::parse_capabilities(
 }
 
 void SmtpProtocol::parse_ehlo_line(
-    const std::string& line,
+    std::string_view line,
     ProtocolAttributes& attrs
-) {
-    std::string capability;
+) const {
+    std::string_view capability;
 
     if (line.find("250-") == 0) {
         capability = line.substr(4);
@@ -198,44 +141,38 @@ void SmtpProtocol::parse_ehlo_line(
         return;
     }
 
-    if (capability == "PIPELINING") {
-        attrs.smtp.pipelining = true;
-    } else if (capability == "STARTTLS") {
-        attrs.smtp.starttls = true;
-    } else if (capability == "8BITMIME") {
-        attrs.smtp._8bitmime = true;
-    } else if (capability == "DSN") {
-        attrs.smtp.dsn = true;
-    } else if (capability == "SMTPUTF8") {
-        attrs.smtp.utf8 = true;
-    } else if (capability.find("SIZE") == 0) {
-        parse_size(capability, attrs);
-    } else if (capability.find("AUTH") == 0) {
-        parse_auth(capability, attrs);
+    auto [keyword, params] = split_keyword(capability);
+    std::size_t k = kEhloKeywords.find(keyword);
+    if (k < std::size(kEhloFlags)) {
+        attrs.smtp.*kEhloFlags[k] = true;
+    } else if (k == kSize) {
+        parse_size(params, attrs);
+    } else if (k == kAuth) {
+        parse_auth(params, attrs);
     }
 }
 
 void SmtpProtocol::parse_size(
-    const std::string& value,
+    std::string_view value,
     ProtocolAttributes& attrs
-) {
-    if (value.find(" ") != std::string::npos) {
-        std::string size_str = value.substr(value.find(" ") + 1);
-        try {
-            attrs.smtp.size_limit = stoull(size_str);
-            attrs.smtp.size_supported = true;
-        } catch (...) {
-            LOG_SMTP_WARN("Failed to parse SIZE: {}", size_str);
-        }
+) const {
+    // 不带参数的 SIZE 表示未声明上限
+    if (value.empty()) return;
+    std::string size_str(value);
+    try {
+        attrs.smtp.size_limit = stoull(size_str);
+        attrs.smtp.size_supported = true;
+    } catch (...) {
+        LOG_SMTP_WARN("Failed to parse SIZE: {}", size_str);
     }
 }
 
 void SmtpProtocol::parse_auth(
-    const std::string& value,
+    std::string_view value,
     ProtocolAttributes& attrs
-) {
-    if (value.find(" ") != std::string::npos) {
-        attrs.smtp.auth_methods = value.substr(value.find(" ") + 1);
+) const {
+    if (!value.empty()) {
+        attrs.smtp.auth_methods = value;
     }
 }
 
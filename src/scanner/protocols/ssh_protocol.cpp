@@ -1,50 +1,60 @@
 #include "scanner/protocols/ssh_protocol.h"
+#include "scanner/protocols/probe_engine.h"
 #include "scanner/common/logger.h"
-#include <boost/asio/read_until.hpp>
-#include <boost/asio/streambuf.hpp>
+#include <openssl/evp.h>
 
 namespace scanner {
 
-namespace asio = boost::asio;
-using tcp = asio::ip::tcp;
-using steady_timer = asio::steady_timer;
-
-struct SshProbeContext {
-    ProtocolResult result;
-    tcp::socket socket;
-    steady_timer timer;
-    asio::streambuf buffer;
-    Timeout timeout;
-    std::function<void(ProtocolResult&&)> on_complete;
-    std::chrono::steady_clock::time_point start_time;
-    bool completed{false};
-
-    SshProbeContext(boost::asio::any_io_executor exec, Timeout t, std::function<void(ProtocolResult&&)> cb)
-        : socket(std::move(exec)), timer(socket.get_executor()), timeout(t), on_complete(std::move(cb)) {}
-
-    void finish_success() {
-        result.accessible = true;
-        auto end = std::chrono::steady_clock::now();
-        result.attrs.response_time_ms =
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time).count();
-        complete();
-    }
+// =====================
+// SSH 探测步骤
+// =====================
 
-    void finish_error(const std::string& msg) {
-        result.error = msg;
-        complete();
-    }
+class SshProtocol::Probe : public ProbeEngine<SshProtocol::Probe> {
+public:
+    explicit Probe(ProbeParams&& params)
+        : ProbeEngine(std::move(params)) {}
+
+private:
+    friend class ProbeEngine<Probe>;
+
+    // SSH 协议在建立 TCP 连接后会立即发送版本标识行，以 "\r\n" 结尾。
+    // SSH-2 服务端随后还会发出 KEXINIT：回送本端标识后在同一连接上读取这一个二进制报文
+    // （多一个 RTT），不继续密钥交换；载荷留在结果中，算法列表与 HASSH 指纹由 enrich 在 CPU 线程池上解析。
+    ProbeTask run() {
+        auto line = co_await read_line("SSH version");
+        banner().assign(line);
+        if (line.substr(0, 8) != "SSH-2.0-" && line.substr(0, 9) != "SSH-1.99-") {
+            finish_success();
+            co_return;
+        }
+        settle();
+
+        static const std::string ident = "SSH-2.0-scanner\r\n";
+        co_await write(ident, "SSH ident");
+
+        // 报文头：uint32 packet_length + byte padding_length；首个报文未加密、无 MAC
+        auto header = co_await read_exact(5, "KEXINIT");
+        if (header.size() < 5) {
+            finish_success();
+            co_return;
+        }
+        auto* h = reinterpret_cast<const uint8_t*>(header.data());
+        std::size_t packet_len = (std::size_t(h[0]) << 24) | (std::size_t(h[1]) << 16) |
+                                 (std::size_t(h[2]) << 8) | h[3];
+        std::size_t padding_len = h[4];
+        if (packet_len < padding_len + 2 || packet_len - 1 > RecvBuffer::kCapacity) {
+            LOG_NETWORK_DEBUG("SSH {}:{} bad packet length {}", target(), port(), packet_len);
+            finish_success();
+            co_return;
+        }
 
-    void complete() {
-        if (completed) return;
-        completed = true;
-        boost::system::error_code ec;
-        (void)timer.cancel();
-        socket.close(ec);
-        if (on_complete) {
-            on_complete(std::move(result));
+        auto body = co_await read_exact(packet_len - 1, "KEXINIT");
+        if (body.size() == packet_len - 1) {
+            result().raw.assign(body.substr(0, packet_len - 1 - padding_len));
         }
+        finish_success();
     }
+
 };
 
 void SshProtocol::async_probe(
@@ -55,52 +65,88 @@ void SshProtocol::async_probe(
     boost::asio::any_io_executor exec,
     std::function<void(ProtocolResult&&)> on_complete
 ) {
-    auto ctx = std::make_shared<SshProbeContext>(std::move(exec), timeout, std::move(on_complete));
-    ctx->result.protocol = name();
-    ctx->result.host = target;
-    ctx->result.port = port;
-    ctx->start_time = std::chrono::steady_clock::now();
-
-    ctx->timer.expires_after(timeout);
-    ctx->timer.async_wait([ctx](const boost::system::error_code& ec) {
-        if (!ec) {
-            ctx->finish_error("SSH probe timed out");
-        }
-    });
+    ProbeEngine<Probe>::launch(
+        ProbeParams{name(), target, ip, port, timeout, std::move(exec), std::move(on_complete), false,
+                    idle_nudge(port), idle_nudge_payload()});
+}
 
-    boost::system::error_code ec;
-    auto address = asio::ip::make_address(ip, ec);
-    if (ec) {
-        ctx->finish_error("Invalid address: " + ec.message());
-        return;
-    }
+void SshProtocol::enrich(ProtocolResult& r) const {
+    parse_kexinit(r.raw, r.attrs);
+}
 
-    tcp::endpoint endpoint(address, port);
-    ctx->socket.async_connect(endpoint, [ctx](const boost::system::error_code& ec) {
-        if (ec) {
-            ctx->finish_error("Connection failed: " + ec.message());
-            return;
-        }
+int SshProtocol::match_greeting(std::string_view greeting) const {
+    return greeting.substr(0, 4) == "SSH-" ? 2 : 0;
+}
 
-        // SSH 协议在建立 TCP 连接后会立即发送版本标识行，以 "\r\n" 结尾
-        asio::async_read_until(ctx->socket, ctx->buffer, "\n",
-            [ctx](const boost::system::error_code& ec, std::size_t /*bytes*/) {
-                if (ec) {
-                    ctx->finish_error("Read SSH version failed: " + ec.message());
-                    return;
-                }
-                std::string banner{
-                    asio::buffers_begin(ctx->buffer.data()),
-                    asio::buffers_end(ctx->buffer.data())
-                };
-                if (!banner.empty() && banner.back() == '\n') banner.pop_back();
-                if (!banner.empty() && banner.back() == '\r') banner.pop_back();
-                ctx->result.attrs.banner = banner;
-                ctx->finish_success();
-            });
-    });
+void SshProtocol::async_probe_connected(
+    ProbeConnection&& conn,
+    const std::string& target,
+    Port port,
+    Timeout timeout,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    auto exec = conn.socket.get_executor();
+    ProbeEngine<Probe>::adopt(
+        ProbeParams{name(), target, {}, port, timeout, std::move(exec), std::move(on_complete)},
+        std::move(conn));
 }
 
 void SshProtocol::parse_capabilities(const std::string&, ProtocolAttributes&) {}
 
+namespace {
+
+constexpr uint8_t kMsgKexInit = 20;
+constexpr std::size_t kCookieLen = 16;
+
+// 读取一个 name-list（uint32 长度 + 逗号分隔的名字），越界返回 false
+bool next_name_list(std::string_view& rest, std::string_view& list) {
+    if (rest.size() < 4) return false;
+    auto* p = reinterpret_cast<const uint8_t*>(rest.data());
+    std::size_t len = (std::size_t(p[0]) << 24) | (std::size_t(p[1]) << 16) |
+                      (std::size_t(p[2]) << 8) | p[3];
+    if (rest.size() - 4 < len) return false;
+    list = rest.substr(4, len);
+    rest.remove_prefix(4 + len);
+    return true;
+}
+
+} // namespace
+
+bool SshProtocol::parse_kexinit(std::string_view payload, ProtocolAttributes& attrs) const {
+    if (payload.size() < 1 + kCookieLen || static_cast<uint8_t>(payload[0]) != kMsgKexInit) {
+        return false;
+    }
+    std::string_view rest = payload.substr(1 + kCookieLen);
+
+    // RFC 4253 7.1：kex, host_key, enc c2s, enc s2c, mac c2s, mac s2c, comp c2s, comp s2c, ...
+    std::string_view lists[8];
+    for (auto& list : lists) {
+        if (!next_name_list(rest, list)) return false;
+    }
+    const auto& kex = lists[0];
+    const auto& ciphers = lists[3];
+    const auto& macs = lists[5];
+    const auto& compression = lists[7];
+
+    // HASSH-server 输入串拼在线程内复用的缓冲里，稳态不分配
+    thread_local std::string hassh_input;
+    hassh_input.clear();
+    hassh_input.append(kex).append(1, ';').append(ciphers).append(1, ';')
+               .append(macs).append(1, ';').append(compression);
+    unsigned int digest_len = 0;
+    if (!EVP_Digest(hassh_input.data(), hassh_input.size(), attrs.ssh.hassh.data(), &digest_len,
+                    EVP_md5(), nullptr) ||
+        digest_len != attrs.ssh.hassh.size()) {
+        return false;
+    }
+
+    attrs.ssh.kexinit = true;
+    attrs.ssh.kex.assign(kex);
+    attrs.ssh.host_key.assign(lists[1]);
+    attrs.ssh.ciphers.assign(ciphers);
+    attrs.ssh.macs.assign(macs);
+    attrs.ssh.compression.assign(compression);
+    return true;
+}
+
 } // namespace scanner
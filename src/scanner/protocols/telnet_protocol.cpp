@@ -1,50 +1,175 @@
 #include "scanner/protocols/telnet_protocol.h"
+#include "scanner/protocols/probe_engine.h"
 #include "scanner/common/logger.h"
-#include <boost/asio/read_until.hpp>
-#include <boost/asio/streambuf.hpp>
+#include <array>
+#include <bitset>
 
 namespace scanner {
 
-namespace asio = boost::asio;
-using tcp = asio::ip::tcp;
-using steady_timer = asio::steady_timer;
-
-struct TelnetProbeContext {
-    ProtocolResult result;
-    tcp::socket socket;
-    steady_timer timer;
-    asio::streambuf buffer;
-    Timeout timeout;
-    std::function<void(ProtocolResult&&)> on_complete;
-    std::chrono::steady_clock::time_point start_time;
-    bool completed{false};
-
-    TelnetProbeContext(boost::asio::any_io_executor exec, Timeout t, std::function<void(ProtocolResult&&)> cb)
-        : socket(std::move(exec)), timer(socket.get_executor()), timeout(t), on_complete(std::move(cb)) {}
-
-    void finish_success() {
-        result.accessible = true;
-        auto end = std::chrono::steady_clock::now();
-        result.attrs.response_time_ms =
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time).count();
-        complete();
+// =====================
+// Telnet 选项协商
+// =====================
+// 逐字节状态机：剥离 IAC 命令与子协商，只保留可打印文本。
+// 对端的 WILL ECHO / WILL SGA / DO SGA 予以同意（登录提示通常在此之后才发出），其余一律拒绝；
+// DONT / WONT 无需应答。每个选项至多应答一次，应答累积在定长数组里，由探测一次写出。
+
+namespace {
+
+constexpr uint8_t kIac = 255;
+constexpr uint8_t kDont = 254;
+constexpr uint8_t kDo = 253;
+constexpr uint8_t kWont = 252;
+constexpr uint8_t kWill = 251;
+constexpr uint8_t kSb = 250;
+constexpr uint8_t kSe = 240;
+constexpr uint8_t kOptEcho = 1;
+constexpr uint8_t kOptSga = 3;
+
+// 首段数据到达后，协商与等待文本的剩余时间上限
+constexpr Timeout kNegotiationWait{1500};
+// 最多读取的轮数（每轮至多回写一次应答）
+constexpr int kMaxRounds = 8;
+
+class TelnetNegotiator {
+public:
+    void feed(std::string_view data) {
+        for (char ch : data) {
+            step(static_cast<uint8_t>(ch));
+        }
+    }
+
+    std::string_view reply() const { return std::string_view(reply_.data(), reply_len_); }
+    void clear_reply() { reply_len_ = 0; }
+
+    // 去掉首尾空白后的文本
+    std::string_view text() const {
+        std::string_view t(text_.data(), text_len_);
+        while (!t.empty() && t.back() == ' ') {
+            t.remove_suffix(1);
+        }
+        return t;
+    }
+
+private:
+    enum class State : uint8_t { Data, Iac, Option, Sub, SubIac };
+
+    void step(uint8_t b) {
+        switch (state_) {
+            case State::Data:
+                if (b == kIac) {
+                    state_ = State::Iac;
+                } else {
+                    put_text(b);
+                }
+                break;
+            case State::Iac:
+                if (b == kDo || b == kDont || b == kWill || b == kWont) {
+                    cmd_ = b;
+                    state_ = State::Option;
+                } else if (b == kSb) {
+                    state_ = State::Sub;
+                } else {
+                    // IAC IAC（数据 0xFF）与 NOP、GA 等单字节命令都不产生文本
+                    state_ = State::Data;
+                }
+                break;
+            case State::Option:
+                answer(cmd_, b);
+                state_ = State::Data;
+                break;
+            case State::Sub:
+                if (b == kIac) state_ = State::SubIac;
+                break;
+            case State::SubIac:
+                state_ = (b == kSe) ? State::Data : State::Sub;
+                break;
+        }
     }
 
-    void finish_error(const std::string& msg) {
-        result.error = msg;
-        complete();
+    void answer(uint8_t cmd, uint8_t opt) {
+        uint8_t verb;
+        if (cmd == kWill) {
+            if (answered_will_[opt]) return;
+            answered_will_[opt] = true;
+            verb = (opt == kOptEcho || opt == kOptSga) ? kDo : kDont;
+        } else if (cmd == kDo) {
+            if (answered_do_[opt]) return;
+            answered_do_[opt] = true;
+            verb = (opt == kOptSga) ? kWill : kWont;
+        } else {
+            return;
+        }
+        if (reply_len_ + 3 > reply_.size()) return;
+        reply_[reply_len_++] = static_cast<char>(kIac);
+        reply_[reply_len_++] = static_cast<char>(verb);
+        reply_[reply_len_++] = static_cast<char>(opt);
     }
 
-    void complete() {
-        if (completed) return;
-        completed = true;
-        boost::system::error_code ec;
-        (void)timer.cancel();
-        socket.close(ec);
-        if (on_complete) {
-            on_complete(std::move(result));
+    // 只收 ASCII 可打印字符；换行与连续空白折叠为一个空格，去掉开头的空白，
+    // 使 banner 保持单行（"Ubuntu 22.04 LTS login:"）
+    void put_text(uint8_t b) {
+        if (text_len_ == text_.size()) return;
+        bool space = b == ' ' || b == '\n' || b == '\r' || b == '\t';
+        if (space) {
+            if (text_len_ > 0 && text_[text_len_ - 1] != ' ') text_[text_len_++] = ' ';
+            return;
         }
+        if (b < 0x20 || b >= 0x7f) return;
+        text_[text_len_++] = static_cast<char>(b);
     }
+
+    State state_ = State::Data;
+    uint8_t cmd_ = 0;
+    std::array<char, 96> reply_;
+    std::size_t reply_len_ = 0;
+    std::array<char, BannerStore::kCapacity> text_;
+    std::size_t text_len_ = 0;
+    std::bitset<256> answered_do_;
+    std::bitset<256> answered_will_;
+};
+
+} // namespace
+
+// =====================
+// Telnet 探测步骤
+// =====================
+
+class TelnetProtocol::Probe : public ProbeEngine<TelnetProtocol::Probe> {
+public:
+    Probe(ProbeParams&& params, TelnetProtocol&)
+        : ProbeEngine(std::move(params)) {}
+
+private:
+    friend class ProbeEngine<Probe>;
+
+    // Telnet 连上后可能先发 IAC 协商、直接发登录提示，或者什么都不发。
+    // 收到首段数据即认定端口可用；之后在有限时间内应答协商、等待第一段可打印文本作为 banner。
+    ProbeTask run() {
+        for (int round = 0; round < kMaxRounds; ++round) {
+            auto data = co_await read_some(1024, "banner");
+            if (round == 0) {
+                settle();
+                tighten_deadline(kNegotiationWait);
+            }
+            negotiator_.feed(data);
+            // 超时或读失败收尾时也保留已得到的文本
+            banner().assign(negotiator_.text());
+            if (!negotiator_.text().empty()) break;
+            if (!negotiator_.reply().empty()) {
+                co_await write(negotiator_.reply(), "IAC reply");
+                negotiator_.clear_reply();
+            }
+        }
+        finish_success();
+    }
+
+    // 即使没有读取到数据，只要连上了也算成功
+    bool on_read_error(const boost::system::error_code&, const char*) {
+        finish_success();
+        return false;
+    }
+
+    TelnetNegotiator negotiator_;
 };
 
 void TelnetProtocol::async_probe(
@@ -55,51 +180,29 @@ void TelnetProtocol::async_probe(
     boost::asio::any_io_executor exec,
     std::function<void(ProtocolResult&&)> on_complete
 ) {
-    auto ctx = std::make_shared<TelnetProbeContext>(std::move(exec), timeout, std::move(on_complete));
-    ctx->result.protocol = name();
-    ctx->result.host = target;
-    ctx->result.port = port;
-    ctx->start_time = std::chrono::steady_clock::now();
-
-    ctx->timer.expires_after(timeout);
-    ctx->timer.async_wait([ctx](const boost::system::error_code& ec) {
-        if (!ec) {
-            ctx->finish_error("Telnet probe timed out");
-        }
-    });
-
-    boost::system::error_code ec;
-    auto address = asio::ip::make_address(ip, ec);
-    if (ec) {
-        ctx->finish_error("Invalid address: " + ec.message());
-        return;
-    }
+    ProbeEngine<Probe>::launch(
+        ProbeParams{name(), target, ip, port, timeout, std::move(exec), std::move(on_complete), false,
+                    idle_nudge(port), idle_nudge_payload()},
+        *this);
+}
 
-    tcp::endpoint endpoint(address, port);
-    ctx->socket.async_connect(endpoint, [ctx](const boost::system::error_code& ec) {
-        if (ec) {
-            ctx->finish_error("Connection failed: " + ec.message());
-            return;
-        }
+// 以 IAC 协商开头的明确是 Telnet；其余无法识别的文本提示（如 "login:"）也按 Telnet 弱匹配
+int TelnetProtocol::match_greeting(std::string_view greeting) const {
+    if (greeting.empty()) return 0;
+    return static_cast<unsigned char>(greeting.front()) == 0xFF ? 2 : 1;
+}
 
-        // Telnet 连上后通常会有欢迎信息，或者什么都不发。
-        // 我们尝试读取一点数据作为 banner。
-        ctx->socket.async_read_some(ctx->buffer.prepare(1024),
-            [ctx](const boost::system::error_code& ec, std::size_t bytes) {
-                if (ec) {
-                    // 即使没有读取到数据，只要连上了也算成功
-                    ctx->finish_success();
-                    return;
-                }
-                ctx->buffer.commit(bytes);
-                std::string banner{
-                    asio::buffers_begin(ctx->buffer.data()),
-                    asio::buffers_begin(ctx->buffer.data()) + std::min(bytes, size_t(256))
-                };
-                ctx->result.attrs.banner = banner;
-                ctx->finish_success();
-            });
-    });
+void TelnetProtocol::async_probe_connected(
+    ProbeConnection&& conn,
+    const std::string& target,
+    Port port,
+    Timeout timeout,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    auto exec = conn.socket.get_executor();
+    ProbeEngine<Probe>::adopt(
+        ProbeParams{name(), target, {}, port, timeout, std::move(exec), std::move(on_complete)},
+        std::move(conn), *this);
 }
 
 void TelnetProtocol::parse_capabilities(const std::string&, ProtocolAttributes&) {}
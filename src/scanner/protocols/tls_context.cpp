@@ -0,0 +1,128 @@
+#include "scanner/protocols/tls_context.h"
+#include "scanner/protocols/cert_cache.h"
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+namespace scanner {
+
+namespace {
+
+constexpr std::size_t kMaxCachedSessions = 4096;
+
+// 线程内的会话缓存（FIFO 淘汰）
+struct ThreadSessionCache {
+    std::unordered_map<std::string, SSL_SESSION*> sessions;
+    std::deque<std::string> order;
+
+    ~ThreadSessionCache() {
+        for (auto& kv : sessions) SSL_SESSION_free(kv.second);
+    }
+};
+
+ThreadSessionCache& session_cache() {
+    thread_local ThreadSessionCache cache;
+    return cache;
+}
+
+std::string session_key(std::string_view ip, Port port) {
+    std::string key(ip);
+    key += ':';
+    key += std::to_string(port);
+    return key;
+}
+
+SSL_SESSION* session_lookup(std::string_view ip, Port port) {
+    auto& cache = session_cache();
+    auto it = cache.sessions.find(session_key(ip, port));
+    if (it == cache.sessions.end() || !SSL_SESSION_is_resumable(it->second)) {
+        return nullptr;
+    }
+    SSL_SESSION_up_ref(it->second);
+    return it->second;
+}
+
+void session_store(std::string_view ip, Port port, SSL_SESSION* session) {
+    if (!session) return;
+    auto& cache = session_cache();
+    auto key = session_key(ip, port);
+    auto it = cache.sessions.find(key);
+    if (it != cache.sessions.end()) {
+        SSL_SESSION_free(it->second);
+        it->second = session;
+        return;
+    }
+    if (cache.sessions.size() >= kMaxCachedSessions && !cache.order.empty()) {
+        auto old = cache.sessions.find(cache.order.front());
+        if (old != cache.sessions.end()) {
+            SSL_SESSION_free(old->second);
+            cache.sessions.erase(old);
+        }
+        cache.order.pop_front();
+    }
+    cache.sessions.emplace(key, session);
+    cache.order.push_back(std::move(key));
+}
+
+// 保存对端绑定的 ex_data 索引
+int peer_index() {
+    static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+// 新会话（含 TLS 1.3 票据）到达时放入当前线程的缓存；返回 1 表示接管引用
+int on_new_session(SSL* ssl, SSL_SESSION* session) {
+    const auto* peer = static_cast<const TlsPeer*>(SSL_get_ex_data(ssl, peer_index()));
+    if (!peer) return 0;
+    session_store(peer->ip, peer->port, session);
+    return 1;
+}
+
+// 线程内的 TLS 客户端上下文
+struct ThreadTlsContext {
+    boost::asio::ssl::context ctx{boost::asio::ssl::context::tls_client};
+
+    ThreadTlsContext() {
+        ctx.set_options(boost::asio::ssl::context::default_workarounds |
+                        boost::asio::ssl::context::no_compression);
+        ctx.set_verify_mode(boost::asio::ssl::verify_none);
+        SSL_CTX* native = ctx.native_handle();
+        // 扫描需要与老旧服务端握手：放开协议下限与安全级别
+        SSL_CTX_set_min_proto_version(native, TLS1_VERSION);
+        SSL_CTX_set_security_level(native, 0);
+        SSL_CTX_set_cipher_list(native, "ALL:@SECLEVEL=0");
+        // 会话由下方的线程内缓存管理，关闭 OpenSSL 内部缓存
+        SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(native, &on_new_session);
+    }
+};
+
+} // namespace
+
+boost::asio::ssl::context& tls_client_context() {
+    thread_local ThreadTlsContext context;
+    return context.ctx;
+}
+
+void tls_prepare_client(SSL* ssl, const TlsPeer& peer, const std::string& server_name) {
+    SSL_set_ex_data(ssl, peer_index(), const_cast<TlsPeer*>(&peer));
+    // SNI 只能携带域名，IP 目标不发送
+    boost::system::error_code ec;
+    boost::asio::ip::make_address(server_name, ec);
+    if (ec && !server_name.empty()) {
+        SSL_set_tlsext_host_name(ssl, server_name.c_str());
+    }
+    if (SSL_SESSION* cached = session_lookup(peer.ip, peer.port)) {
+        SSL_set_session(ssl, cached);
+        SSL_SESSION_free(cached);
+    }
+}
+
+void tls_inspect_certificate(ProtocolAttributes& attrs) {
+    auto& tls = attrs.tls;
+    if (tls.cert_der.empty()) return;
+    tls.cert_id = CertificateCache::instance().intern(tls.cert_der);
+    std::string().swap(tls.cert_der);
+}
+
+} // namespace scanner
@@ -0,0 +1,347 @@
+#include "scanner/protocols/udp_hub.h"
+#include "scanner/common/logger.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+
+namespace scanner {
+
+namespace {
+
+constexpr std::size_t kSendBatch = 64;       // 单次 sendmmsg 的报文数
+constexpr std::size_t kRecvBatch = 32;       // 单次 recvmmsg 的报文数
+constexpr std::size_t kDrainRounds = 8;      // 单次可读通知最多调用 recvmmsg 的次数
+constexpr std::size_t kMaxDatagram = 2048;   // 更长的应答被截断，解析只看前面部分
+constexpr int kSocketBuffer = 4 * 1024 * 1024;
+
+} // namespace
+
+// =====================
+// UdpProtocol
+// =====================
+
+void UdpProtocol::async_probe(
+    const std::string& target,
+    const std::string& ip,
+    Port port,
+    Timeout timeout,
+    boost::asio::any_io_executor exec,
+    std::function<void(ProtocolResult&&)> on_complete
+) {
+    // 调用方在扫描线程上，收发中枢属于 exec 所在的 IO 线程
+    asio::post(exec, [this, target, ip, port, timeout, exec, on_complete = std::move(on_complete)]() mutable {
+        boost::system::error_code ec;
+        auto addr = asio::ip::make_address(ip, ec);
+        if (ec) {
+            ProtocolResult r;
+            r.protocol = name();
+            r.host = target;
+            r.port = port;
+            r.error = "Invalid address: " + ec.message();
+            on_complete(std::move(r));
+            return;
+        }
+        UdpHub::local(exec).submit(*this, addr, port, target, timeout, std::move(on_complete));
+    });
+}
+
+// =====================
+// 套接字
+// =====================
+
+UdpHub::Slot::Slot(const asio::any_io_executor& exec, const asio::ip::udp& family)
+    : socket(exec), timer(exec) {
+    socket.open(family);
+    socket.bind(asio::ip::udp::endpoint(family, 0));
+    socket.non_blocking(true);
+    // 大批应答集中到达，放大缓冲减少丢包
+    int size = kSocketBuffer;
+    (void)::setsockopt(socket.native_handle(), SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    (void)::setsockopt(socket.native_handle(), SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+}
+
+UdpHub& UdpHub::local(const asio::any_io_executor& exec) {
+    thread_local std::unique_ptr<UdpHub> hub;
+    if (!hub) hub = std::make_unique<UdpHub>(exec);
+    return *hub;
+}
+
+UdpHub::UdpHub(const asio::any_io_executor& exec)
+    : exec_(exec), next_txid_(std::random_device{}()), recv_buf_(kRecvBatch * kMaxDatagram) {}
+
+UdpHub::~UdpHub() = default;
+
+std::size_t UdpHub::FlowKeyHash::operator()(const FlowKey& k) const {
+    std::size_t h = std::hash<std::string_view>{}(
+        std::string_view(reinterpret_cast<const char*>(k.addr.data()), k.addr.size()));
+    return h ^ ((uint64_t(k.port) << 32 | k.txid) * 0x9e3779b97f4a7c15ull);
+}
+
+UdpHub::FlowKey UdpHub::make_key(const asio::ip::address& addr, Port port, uint32_t txid) {
+    FlowKey key;
+    if (addr.is_v4()) {
+        // IPv4 按 v4-mapped 形式存放
+        auto b = addr.to_v4().to_bytes();
+        key.addr[10] = key.addr[11] = 0xff;
+        std::copy(b.begin(), b.end(), key.addr.begin() + 12);
+    } else {
+        auto b = addr.to_v6().to_bytes();
+        std::copy(b.begin(), b.end(), key.addr.begin());
+    }
+    key.port = port;
+    key.txid = txid;
+    return key;
+}
+
+UdpHub::Slot* UdpHub::pick_slot(bool v6) {
+    auto& slots = v6 ? v6_ : v4_;
+    auto& next = v6 ? next_v6_ : next_v4_;
+    if (slots.empty()) {
+        try {
+            for (std::size_t i = 0; i < kSocketsPerFamily; ++i) {
+                slots.push_back(std::make_unique<Slot>(exec_, v6 ? asio::ip::udp::v6() : asio::ip::udp::v4()));
+                wait_readable(*slots.back());
+            }
+        } catch (const boost::system::system_error& e) {
+            LOG_NETWORK_ERROR("Failed to open UDP {} socket: {}", v6 ? "IPv6" : "IPv4", e.what());
+            if (slots.empty()) return nullptr;
+        }
+    }
+    return slots[next++ % slots.size()].get();
+}
+
+// =====================
+// 提交与批量发送
+// =====================
+
+void UdpHub::submit(const UdpProtocol& proto, const asio::ip::address& addr, Port port, const std::string& target,
+                    Timeout timeout, std::function<void(ProtocolResult&&)> on_complete) {
+    ProtocolResult result;
+    result.protocol = proto.name();
+    result.host = target;
+    result.port = port;
+
+    Slot* slot = pick_slot(addr.is_v6());
+    if (!slot) {
+        result.error = "UDP socket unavailable";
+        on_complete(std::move(result));
+        return;
+    }
+
+    // 找一个该端点上未被占用的事务 ID；报文不带事务 ID 的协议同一端点只能有一个请求
+    const uint32_t mask = proto.txid_mask();
+    FlowKey key;
+    bool free = false;
+    for (int attempt = 0; attempt < 8 && !free; ++attempt) {
+        key = make_key(addr, port, next_txid_++ & mask);
+        free = pending_.find(key) == pending_.end();
+        if (mask == 0) break;
+    }
+    if (!free) {
+        result.error = "Another " + result.protocol + " probe to this endpoint is in flight";
+        on_complete(std::move(result));
+        return;
+    }
+
+    auto& known = protocols_by_port_[port];
+    if (std::find(known.begin(), known.end(), &proto) == known.end()) known.push_back(&proto);
+
+    Outgoing& out = slot->sendq.emplace_back();
+    out.key = key;
+    out.id = next_id_++;
+    out.to = asio::ip::udp::endpoint(addr, port);
+    out.len = proto.build_request(key.txid, target, out.data.data());
+
+    Pending& p = pending_[key];
+    p.proto = &proto;
+    p.id = out.id;
+    p.timeout = timeout;
+    p.result = std::move(result);
+    p.on_complete = std::move(on_complete);
+
+    schedule_flush(*slot);
+}
+
+void UdpHub::schedule_flush(Slot& slot) {
+    if (slot.flush_scheduled || slot.waiting_write) return;
+    slot.flush_scheduled = true;
+    // 延到本轮已排队的提交都处理完再发，同一批请求合并进一次 sendmmsg
+    asio::post(exec_, [this, &slot]() {
+        slot.flush_scheduled = false;
+        flush(slot);
+    });
+}
+
+void UdpHub::flush(Slot& slot) {
+    auto& q = slot.sendq;
+    std::size_t done = 0;
+    bool blocked = false;
+    while (done < q.size() && !blocked) {
+        std::size_t n = std::min(kSendBatch, q.size() - done);
+        mmsghdr msgs[kSendBatch];
+        iovec iov[kSendBatch];
+        for (std::size_t i = 0; i < n; ++i) {
+            Outgoing& o = q[done + i];
+            iov[i].iov_base = o.data.data();
+            iov[i].iov_len = o.len;
+            std::memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = o.to.data();
+            msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(o.to.size());
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int sent = ::sendmmsg(slot.socket.native_handle(), msgs, static_cast<unsigned>(n), MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                blocked = true;
+                break;
+            }
+            // 出错的是本批第一条（如目标网络不可达）：单独判失败，其余继续
+            fail(q[done].key, q[done].id, std::string("Send failed: ") + std::strerror(errno));
+            ++done;
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (int i = 0; i < sent; ++i) {
+            const Outgoing& o = q[done + i];
+            auto it = pending_.find(o.key);
+            if (it == pending_.end() || it->second.id != o.id) continue;
+            it->second.sent_at = now;
+            arm_deadline(slot, o.key, o.id, now + it->second.timeout);
+        }
+        done += static_cast<std::size_t>(sent);
+    }
+    q.erase(q.begin(), q.begin() + static_cast<std::ptrdiff_t>(done));
+
+    if (blocked) {
+        slot.waiting_write = true;
+        slot.socket.async_wait(asio::ip::udp::socket::wait_write, [this, &slot](const boost::system::error_code& ec) {
+            slot.waiting_write = false;
+            if (ec) return;
+            flush(slot);
+        });
+    }
+}
+
+// =====================
+// 超时
+// =====================
+// 同一套接字上的期限放在一个最小堆里，定时器只等堆顶；已收到应答的条目留在堆中，
+// 到期弹出时按 id 对不上即跳过。
+
+void UdpHub::arm_deadline(Slot& slot, const FlowKey& key, uint64_t id, std::chrono::steady_clock::time_point at) {
+    slot.deadlines.push(Deadline{at, key, id});
+    if (slot.deadlines.top().id != id) return;  // 已有更早的期限在等
+    slot.timer.expires_at(at);
+    slot.timer.async_wait([this, &slot](const boost::system::error_code& ec) {
+        if (ec) return;
+        expire(slot);
+    });
+}
+
+void UdpHub::expire(Slot& slot) {
+    auto now = std::chrono::steady_clock::now();
+    while (!slot.deadlines.empty() && slot.deadlines.top().at <= now) {
+        Deadline d = slot.deadlines.top();
+        slot.deadlines.pop();
+        fail(d.key, d.id, {});
+    }
+    if (slot.deadlines.empty()) return;
+    slot.timer.expires_at(slot.deadlines.top().at);
+    slot.timer.async_wait([this, &slot](const boost::system::error_code& ec) {
+        if (ec) return;
+        expire(slot);
+    });
+}
+
+void UdpHub::fail(const FlowKey& key, uint64_t id, std::string error) {
+    auto it = pending_.find(key);
+    if (it == pending_.end() || it->second.id != id) return;
+    Pending p = std::move(it->second);
+    pending_.erase(it);
+    p.result.error = error.empty() ? p.result.protocol + " probe timed out" : std::move(error);
+    p.on_complete(std::move(p.result));
+}
+
+// =====================
+// 接收与分派
+// =====================
+
+void UdpHub::wait_readable(Slot& slot) {
+    slot.socket.async_wait(asio::ip::udp::socket::wait_read, [this, &slot](const boost::system::error_code& ec) {
+        if (ec) return;
+        drain(slot);
+        wait_readable(slot);
+    });
+}
+
+void UdpHub::drain(Slot& slot) {
+    mmsghdr msgs[kRecvBatch];
+    iovec iov[kRecvBatch];
+    sockaddr_storage from[kRecvBatch];
+    for (std::size_t round = 0; round < kDrainRounds; ++round) {
+        for (std::size_t i = 0; i < kRecvBatch; ++i) {
+            iov[i].iov_base = recv_buf_.data() + i * kMaxDatagram;
+            iov[i].iov_len = kMaxDatagram;
+            std::memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = ::recvmmsg(slot.socket.native_handle(), msgs, kRecvBatch, MSG_DONTWAIT, nullptr);
+        if (n <= 0) return;
+
+        for (int i = 0; i < n; ++i) {
+            asio::ip::address addr;
+            Port port = 0;
+            if (from[i].ss_family == AF_INET) {
+                const auto* sa = reinterpret_cast<const sockaddr_in*>(&from[i]);
+                addr = asio::ip::address_v4(ntohl(sa->sin_addr.s_addr));
+                port = ntohs(sa->sin_port);
+            } else if (from[i].ss_family == AF_INET6) {
+                const auto* sa = reinterpret_cast<const sockaddr_in6*>(&from[i]);
+                asio::ip::address_v6::bytes_type bytes;
+                std::memcpy(bytes.data(), sa->sin6_addr.s6_addr, bytes.size());
+                addr = asio::ip::address_v6(bytes);
+                port = ntohs(sa->sin6_port);
+            } else {
+                continue;
+            }
+            std::string_view data(reinterpret_cast<const char*>(iov[i].iov_base),
+                                  std::min<std::size_t>(msgs[i].msg_len, kMaxDatagram));
+            handle_datagram(addr, port, data);
+        }
+        if (static_cast<std::size_t>(n) < kRecvBatch) return;
+    }
+}
+
+void UdpHub::handle_datagram(const asio::ip::address& from, Port port, std::string_view data) {
+    auto known = protocols_by_port_.find(port);
+    if (known == protocols_by_port_.end()) return;
+
+    for (const UdpProtocol* proto : known->second) {
+        uint32_t txid = 0;
+        if (!proto->response_txid(data, txid)) continue;
+        auto it = pending_.find(make_key(from, port, txid & proto->txid_mask()));
+        if (it == pending_.end() || it->second.proto != proto) continue;
+
+        Pending p = std::move(it->second);
+        pending_.erase(it);
+        auto elapsed = std::chrono::steady_clock::now() - p.sent_at;
+        p.result.accessible = true;
+        p.result.attrs.response_time_ms =
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1000.0;
+        proto->parse_response(data, p.result.attrs);
+        p.on_complete(std::move(p.result));
+        return;
+    }
+}
+
+} // namespace scanner
@@ -0,0 +1,409 @@
+#include "scanner/protocols/udp_protocols.h"
+#include "scanner/protocols/recv_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace scanner {
+
+namespace {
+
+constexpr std::size_t kBannerMax = 256;
+
+// 只保留可打印字符，控制字符折成空格，过长截断
+std::string printable(std::string_view s) {
+    std::string out;
+    out.reserve(std::min(s.size(), kBannerMax));
+    for (char c : s) {
+        if (out.size() == kBannerMax) break;
+        auto u = static_cast<unsigned char>(c);
+        if (u >= 0x20 && u < 0x7f) out.push_back(c);
+        else if (!out.empty() && out.back() != ' ') out.push_back(' ');
+    }
+    while (!out.empty() && out.back() == ' ') out.pop_back();
+    return out;
+}
+
+inline uint16_t be16(const unsigned char* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline const unsigned char* bytes(std::string_view s) {
+    return reinterpret_cast<const unsigned char*>(s.data());
+}
+
+} // namespace
+
+// =====================
+// DNS version.bind
+// =====================
+
+namespace {
+
+constexpr unsigned char kVersionBindQuestion[] = {
+    7, 'v', 'e', 'r', 's', 'i', 'o', 'n', 4, 'b', 'i', 'n', 'd', 0,
+    0x00, 0x10,   // TXT
+    0x00, 0x03,   // CH
+};
+
+const char* rcode_name(unsigned rcode) {
+    switch (rcode) {
+        case 0: return "NOERROR";
+        case 1: return "FORMERR";
+        case 2: return "SERVFAIL";
+        case 3: return "NXDOMAIN";
+        case 4: return "NOTIMP";
+        case 5: return "REFUSED";
+        default: return nullptr;
+    }
+}
+
+// 跳过一个（可能带压缩指针的）域名，越界返回 false
+bool skip_name(std::string_view data, std::size_t& off) {
+    const unsigned char* p = bytes(data);
+    while (off < data.size()) {
+        unsigned len = p[off];
+        if (len == 0) { off += 1; return true; }
+        if ((len & 0xc0) == 0xc0) { off += 2; return off <= data.size(); }
+        if (len & 0xc0) return false;
+        off += 1 + len;
+    }
+    return false;
+}
+
+} // namespace
+
+std::size_t DnsVersionProtocol::build_request(uint32_t txid, const std::string&, unsigned char* buf) const {
+    std::memset(buf, 0, 12);
+    buf[0] = static_cast<unsigned char>(txid >> 8);
+    buf[1] = static_cast<unsigned char>(txid);
+    buf[5] = 1;   // QDCOUNT
+    std::memcpy(buf + 12, kVersionBindQuestion, sizeof(kVersionBindQuestion));
+    return 12 + sizeof(kVersionBindQuestion);
+}
+
+bool DnsVersionProtocol::response_txid(std::string_view data, uint32_t& txid) const {
+    if (data.size() < 12) return false;
+    const unsigned char* p = bytes(data);
+    if (!(p[2] & 0x80)) return false;   // QR
+    txid = be16(p);
+    return true;
+}
+
+void DnsVersionProtocol::parse_response(std::string_view data, ProtocolAttributes& attrs) const {
+    const unsigned char* p = bytes(data);
+    unsigned rcode = p[3] & 0x0f;
+    const char* rname = rcode_name(rcode);
+    std::string rcode_str = rname ? rname : std::to_string(rcode);
+    attrs.fields.emplace_back("rcode", rcode_str);
+
+    uint16_t qdcount = be16(p + 4);
+    uint16_t ancount = be16(p + 6);
+    std::size_t off = 12;
+    for (uint16_t i = 0; i < qdcount; ++i) {
+        if (!skip_name(data, off) || off + 4 > data.size()) { off = data.size(); break; }
+        off += 4;
+    }
+
+    std::string version;
+    for (uint16_t i = 0; i < ancount && version.empty(); ++i) {
+        if (!skip_name(data, off) || off + 10 > data.size()) break;
+        uint16_t type = be16(p + off);
+        uint16_t rdlen = be16(p + off + 8);
+        off += 10;
+        if (off + rdlen > data.size()) break;
+        if (type == 16) {
+            // TXT RDATA：若干 <长度><字符串>，拼接
+            std::size_t r = off, end = off + rdlen;
+            while (r < end) {
+                std::size_t n = p[r++];
+                if (r + n > end) break;
+                version.append(data.substr(r, n));
+                r += n;
+            }
+        }
+        off += rdlen;
+    }
+
+    version = printable(version);
+    if (!version.empty()) {
+        attrs.fields.emplace_back("version", version);
+        attrs.banner = version;
+    } else {
+        attrs.banner = "rcode=" + rcode_str;
+    }
+}
+
+// =====================
+// NTP mode 6 / mode 7
+// =====================
+
+std::size_t NtpProtocol::build_request(uint32_t txid, const std::string&, unsigned char* buf) const {
+    std::memset(buf, 0, 12);
+    buf[0] = 0x16;   // LI=0, VN=2, mode 6
+    buf[1] = 0x02;   // READVAR
+    buf[2] = static_cast<unsigned char>(txid >> 8);
+    buf[3] = static_cast<unsigned char>(txid);
+    return 12;
+}
+
+bool NtpProtocol::response_txid(std::string_view data, uint32_t& txid) const {
+    if (data.size() < 12) return false;
+    const unsigned char* p = bytes(data);
+    if ((p[0] & 0x07) != 6 || !(p[1] & 0x80)) return false;
+    txid = be16(p + 2);
+    return true;
+}
+
+void NtpProtocol::parse_response(std::string_view data, ProtocolAttributes& attrs) const {
+    const unsigned char* p = bytes(data);
+    if (p[1] & 0x40) {
+        attrs.fields.emplace_back("error", std::to_string(p[4]));   // 出错时状态字高字节为错误码
+        attrs.banner = "mode 6 error";
+        return;
+    }
+    std::size_t count = be16(p + 10);
+    std::string_view text = data.substr(12, std::min(count, data.size() - 12));
+
+    // 形如 version="ntpd 4.2.8p15", processor="x86_64", stratum=2, ...（可跨行）
+    static constexpr std::string_view kKeep[] = {"version", "system", "processor", "stratum", "refid"};
+    std::string version;
+    while (!text.empty()) {
+        std::size_t eq = text.find('=');
+        if (eq == std::string_view::npos) break;
+        std::string_view key = text.substr(0, eq);
+        while (!key.empty() && (key.front() == ' ' || key.front() == ',' || key.front() == '\r' || key.front() == '\n'))
+            key.remove_prefix(1);
+        text.remove_prefix(eq + 1);
+
+        std::string_view value;
+        if (!text.empty() && text.front() == '"') {
+            std::size_t close = text.find('"', 1);
+            if (close == std::string_view::npos) close = text.size();
+            value = text.substr(1, close - 1);
+            text.remove_prefix(std::min(close + 1, text.size()));
+        } else {
+            std::size_t comma = text.find(',');
+            value = text.substr(0, comma);
+            text.remove_prefix(comma == std::string_view::npos ? text.size() : comma);
+        }
+        while (!value.empty() && (value.back() == '\r' || value.back() == '\n' || value.back() == ' '))
+            value.remove_suffix(1);
+
+        for (auto k : kKeep) {
+            if (key != k) continue;
+            attrs.fields.emplace_back(std::string(k), printable(value));
+            if (k == "version") version = printable(value);
+        }
+    }
+    attrs.banner = version.empty() ? "mode 6 response" : version;
+}
+
+std::size_t NtpPrivateProtocol::build_request(uint32_t txid, const std::string&, unsigned char* buf) const {
+    std::memset(buf, 0, 48);
+    buf[0] = 0x17;                                      // R=0, M=0, VN=2, mode 7
+    buf[1] = static_cast<unsigned char>(txid & 0x7f);   // A=0, 序列号
+    buf[2] = 3;                                         // IMPL_XNTPD
+    buf[3] = 0;                                         // REQ_PEER_LIST
+    return 48;
+}
+
+bool NtpPrivateProtocol::response_txid(std::string_view data, uint32_t& txid) const {
+    if (data.size() < 8) return false;
+    const unsigned char* p = bytes(data);
+    if ((p[0] & 0x07) != 7 || !(p[0] & 0x80)) return false;
+    txid = p[1] & 0x7f;
+    return true;
+}
+
+void NtpPrivateProtocol::parse_response(std::string_view data, ProtocolAttributes& attrs) const {
+    const unsigned char* p = bytes(data);
+    unsigned err = p[4] >> 4;
+    unsigned items = ((p[4] & 0x0f) << 8) | p[5];
+    attrs.fields.emplace_back("error", std::to_string(err));
+    attrs.fields.emplace_back("items", std::to_string(items));
+    attrs.banner = err == 0 ? "mode 7 enabled, " + std::to_string(items) + " peers"
+                            : "mode 7 error " + std::to_string(err);
+}
+
+// =====================
+// SNMPv2c sysDescr.0
+// =====================
+
+namespace {
+
+constexpr std::string_view kCommunity = "public";
+constexpr unsigned char kSysDescrOid[] = {0x2b, 6, 1, 2, 1, 1, 1, 0};   // 1.3.6.1.2.1.1.1.0
+
+// 顺序读取 BER TLV；只支持一字节标签，长度最多 4 字节
+struct BerReader {
+    std::string_view data;
+
+    bool next(unsigned char& tag, std::string_view& body) {
+        if (data.size() < 2) return false;
+        const unsigned char* p = bytes(data);
+        tag = p[0];
+        std::size_t len = p[1];
+        std::size_t hdr = 2;
+        if (len & 0x80) {
+            std::size_t n = len & 0x7f;
+            if (n == 0 || n > 4 || data.size() < 2 + n) return false;
+            len = 0;
+            for (std::size_t i = 0; i < n; ++i) len = (len << 8) | p[2 + i];
+            hdr += n;
+        }
+        if (data.size() - hdr < len) return false;
+        body = data.substr(hdr, len);
+        data.remove_prefix(hdr + len);
+        return true;
+    }
+
+    bool expect(unsigned char want, std::string_view& body) {
+        unsigned char tag = 0;
+        return next(tag, body) && tag == want;
+    }
+};
+
+bool ber_uint(std::string_view body, uint32_t& out) {
+    if (body.empty() || body.size() > 5) return false;
+    uint64_t v = 0;
+    for (unsigned char c : body) v = (v << 8) | c;
+    out = static_cast<uint32_t>(v);
+    return true;
+}
+
+// 进入 GetResponse PDU，读出 request-id
+bool open_response(std::string_view data, BerReader& pdu, uint32_t& request_id) {
+    BerReader msg{data};
+    std::string_view body;
+    if (!msg.expect(0x30, body)) return false;
+    BerReader seq{body};
+    std::string_view version, community, pdu_body;
+    if (!seq.expect(0x02, version) || !seq.expect(0x04, community) || !seq.expect(0xa2, pdu_body)) return false;
+    pdu.data = pdu_body;
+    std::string_view rid;
+    return pdu.expect(0x02, rid) && ber_uint(rid, request_id);
+}
+
+} // namespace
+
+std::size_t SnmpProtocol::build_request(uint32_t txid, const std::string&, unsigned char* buf) const {
+    // request-id 取最短编码；最高位为 1 时前补 0 保持为正数
+    unsigned char rid[5];
+    std::size_t rid_len = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        auto b = static_cast<unsigned char>(txid >> shift);
+        if (rid_len == 0 && b == 0 && shift != 0) continue;
+        if (rid_len == 0 && (b & 0x80)) rid[rid_len++] = 0;
+        rid[rid_len++] = b;
+    }
+
+    const std::size_t varbind = 2 + 2 + sizeof(kSysDescrOid) + 2;      // SEQ{OID, NULL}
+    const std::size_t varbinds = 2 + varbind;
+    const std::size_t pdu = 2 + rid_len + 3 + 3 + varbinds;
+    const std::size_t msg = 3 + 2 + kCommunity.size() + 2 + pdu;
+
+    unsigned char* w = buf;
+    auto put = [&](std::initializer_list<unsigned char> b) { for (auto c : b) *w++ = c; };
+    put({0x30, static_cast<unsigned char>(msg)});
+    put({0x02, 0x01, 0x01});                                        // version: v2c
+    put({0x04, static_cast<unsigned char>(kCommunity.size())});
+    std::memcpy(w, kCommunity.data(), kCommunity.size());
+    w += kCommunity.size();
+    put({0xa0, static_cast<unsigned char>(pdu)});                   // GetRequest
+    put({0x02, static_cast<unsigned char>(rid_len)});
+    std::memcpy(w, rid, rid_len);
+    w += rid_len;
+    put({0x02, 0x01, 0x00, 0x02, 0x01, 0x00});                      // error-status, error-index
+    put({0x30, static_cast<unsigned char>(varbind)});
+    put({0x30, static_cast<unsigned char>(varbind - 2)});
+    put({0x06, static_cast<unsigned char>(sizeof(kSysDescrOid))});
+    std::memcpy(w, kSysDescrOid, sizeof(kSysDescrOid));
+    w += sizeof(kSysDescrOid);
+    put({0x05, 0x00});
+    return static_cast<std::size_t>(w - buf);
+}
+
+bool SnmpProtocol::response_txid(std::string_view data, uint32_t& txid) const {
+    BerReader pdu;
+    return open_response(data, pdu, txid);
+}
+
+void SnmpProtocol::parse_response(std::string_view data, ProtocolAttributes& attrs) const {
+    BerReader pdu;
+    uint32_t request_id = 0;
+    std::string_view status, index, varbinds;
+    uint32_t error_status = 0;
+    if (!open_response(data, pdu, request_id) || !pdu.expect(0x02, status) || !pdu.expect(0x02, index) ||
+        !pdu.expect(0x30, varbinds) || !ber_uint(status, error_status)) {
+        attrs.banner = "malformed response";
+        return;
+    }
+    if (error_status != 0) {
+        attrs.fields.emplace_back("error_status", std::to_string(error_status));
+        attrs.banner = "error-status " + std::to_string(error_status);
+        return;
+    }
+
+    BerReader list{varbinds};
+    std::string_view vb, oid, value;
+    unsigned char tag = 0;
+    if (list.expect(0x30, vb)) {
+        BerReader item{vb};
+        if (item.expect(0x06, oid) && item.next(tag, value) && tag == 0x04) {
+            std::string descr = printable(value);
+            attrs.fields.emplace_back("sysDescr", descr);
+            attrs.banner = descr;
+            return;
+        }
+    }
+    attrs.banner = "no sysDescr";   // noSuchObject 等异常值
+}
+
+// =====================
+// SSDP M-SEARCH
+// =====================
+
+namespace {
+
+constexpr std::string_view kMSearch =
+    "M-SEARCH * HTTP/1.1\r\n"
+    "HOST: 239.255.255.250:1900\r\n"
+    "MAN: \"ssdp:discover\"\r\n"
+    "MX: 1\r\n"
+    "ST: upnp:rootdevice\r\n"
+    "\r\n";
+
+} // namespace
+
+std::size_t SsdpProtocol::build_request(uint32_t, const std::string&, unsigned char* buf) const {
+    std::memcpy(buf, kMSearch.data(), kMSearch.size());
+    return kMSearch.size();
+}
+
+bool SsdpProtocol::response_txid(std::string_view data, uint32_t& txid) const {
+    if (data.substr(0, 7) != "HTTP/1.") return false;
+    txid = 0;
+    return true;
+}
+
+void SsdpProtocol::parse_response(std::string_view data, ProtocolAttributes& attrs) const {
+    static constexpr std::string_view kHeaders[] = {"server", "location", "usn", "st"};
+    std::string_view line;
+    std::string server;
+    next_line(data, line);   // 状态行
+    while (next_line(data, line) && !line.empty()) {
+        std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = line.substr(colon + 1);
+        while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+        for (auto header : kHeaders) {
+            if (name.size() != header.size() || find_ignore_case(name, header) != 0) continue;
+            attrs.fields.emplace_back(std::string(header), printable(value));
+            if (header == "server") server = printable(value);
+        }
+    }
+    attrs.banner = server.empty() ? "SSDP response" : server;
+}
+
+} // namespace scanner
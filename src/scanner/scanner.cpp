@@ -1,5 +1,8 @@
 #include "scanner/core/scanner.h"
 #include "scanner/dns/dns_resolver.h"
+#include "scanner/core/dns_prefetcher.h"
+#include "scanner/core/enrich_stage.h"
+#include "scanner/network/port_scanner.h"
 #include "scanner/common/logger.h"
 #include "scanner/common/io_thread_pool.h"
 #include "scanner/protocols/smtp_protocol.h"
@@ -9,6 +12,11 @@
 #include "scanner/protocols/ftp_protocol.h"
 #include "scanner/protocols/telnet_protocol.h"
 #include "scanner/protocols/ssh_protocol.h"
+#include "scanner/protocols/cert_cache.h"
+#include "scanner/protocols/probe_engine.h"
+#include "scanner/protocols/scripted_protocol.h"
+#include "scanner/protocols/service_protocol.h"
+#include "scanner/protocols/udp_protocols.h"
 #include <algorithm>
 #include <thread>
 #include <chrono>
@@ -25,11 +33,29 @@ Scanner::Scanner(const ScannerConfig& config)
     int cpu_threads = config.cpu_thread_count > 0 ? config.cpu_thread_count : std::max(1, config.thread_count / 4);
 
     scan_pool_ = std::make_shared<ThreadPool>(std::max(1, cpu_threads));
+    enrich_stage_ = std::make_unique<EnrichStage>(*scan_pool_);
     io_pool_ = std::make_shared<IoThreadPool>(std::max(1, io_threads));
 
     LOG_CORE_INFO("Thread pools initialized: IO={} CPU={}", io_threads, cpu_threads);
     
     dns_resolver_ = DnsResolverFactory::create(DnsResolverFactory::ResolverType::C_ARES);
+    dns_prefetcher_ = std::make_unique<DnsPrefetcher>(
+        static_cast<size_t>(std::max(1, config.dns_prefetch_workers)),
+        config.dns_timeout,
+        config.dns_lookahead_min,
+        config.dns_lookahead_max);
+    if (config.port_prepass) {
+        PortScannerConfig pc;
+        // 期限须覆盖 SYN 的首次重传（约 1 秒），默认沿用探测超时
+        pc.connect_timeout = config.port_prepass_timeout.count() > 0 ? config.port_prepass_timeout
+                           : config.probe_timeout.count() > 0     ? config.probe_timeout
+                                                                  : std::chrono::milliseconds(3000);
+        pc.max_inflight = config.port_prepass_max_inflight;
+        pc.rate_per_sec = config.port_prepass_rate;
+        pc.syn_scan = config.port_prepass_syn;
+        pc.syn_retries = config.port_prepass_syn_retries;
+        port_scanner_ = std::make_shared<PortScanner>(*io_pool_, pc);
+    }
     init_protocols();
 }
 
@@ -38,6 +64,8 @@ Scanner::~Scanner() {
     if (input_thread_.joinable()) input_thread_.join();
     if (result_thread_.joinable()) result_thread_.join();
     if (scan_thread_.joinable()) scan_thread_.join();
+    if (dns_prefetcher_) dns_prefetcher_->shutdown();
+    if (port_scanner_) port_scanner_->shutdown();
     if (scan_pool_) scan_pool_->shutdown();
     if (io_pool_) io_pool_->shutdown();
 }
@@ -63,19 +91,107 @@ Scanner::ScanStatistics Scanner::get_statistics() const {
             stats.total_time = std::chrono::milliseconds(0);
         }
     }
+
+    if (dns_prefetcher_) {
+        auto ps = dns_prefetcher_->stats();
+        stats.dns_prefetch_hits = ps.hits;
+        stats.dns_prefetch_misses = ps.misses;
+        stats.dns_lookahead_window = ps.window;
+        stats.dns_avg_latency_ms = ps.avg_dns_ms;
+    }
+
+    if (port_scanner_) {
+        auto ps = port_scanner_->stats();
+        stats.port_attempts = ps.attempts;
+        stats.port_open = ps.open;
+        stats.port_refused = ps.refused;
+        stats.port_filtered = ps.filtered;
+        stats.port_syn_sent = ps.syn_sent;
+    }
     
     return stats;
 }
 
 void Scanner::init_protocols() {
     protocols_.clear();
-    if (config_.enable_smtp) protocols_.push_back(std::make_unique<SmtpProtocol>());
-    if (config_.enable_pop3) protocols_.push_back(std::make_unique<Pop3Protocol>());
-    if (config_.enable_imap) protocols_.push_back(std::make_unique<ImapProtocol>());
-    if (config_.enable_http) protocols_.push_back(std::make_unique<HttpProtocol>());
-    if (config_.enable_ftp) protocols_.push_back(std::make_unique<FtpProtocol>());
+    if (config_.enable_smtp) {
+        auto smtp = std::make_unique<SmtpProtocol>();
+        smtp->set_starttls(config_.starttls);
+        smtp->set_optimistic(config_.optimistic_commands);
+        protocols_.push_back(std::move(smtp));
+    }
+    if (config_.enable_pop3) {
+        auto pop3 = std::make_unique<Pop3Protocol>();
+        pop3->set_starttls(config_.starttls);
+        pop3->set_optimistic(config_.optimistic_commands);
+        protocols_.push_back(std::move(pop3));
+    }
+    if (config_.enable_imap) {
+        auto imap = std::make_unique<ImapProtocol>();
+        imap->set_starttls(config_.starttls);
+        imap->set_optimistic(config_.optimistic_commands);
+        protocols_.push_back(std::move(imap));
+    }
+    if (config_.enable_http) {
+        auto http = std::make_unique<HttpProtocol>();
+        std::vector<HttpRequestSpec> requests;
+        for (const auto& r : config_.http_requests) requests.push_back(HttpRequestSpec::parse(r));
+        http->set_requests(std::move(requests));
+        http->set_vhost_connections(config_.http_vhost_connections);
+        protocols_.push_back(std::move(http));
+    }
+    if (config_.enable_ftp) {
+        auto ftp = std::make_unique<FtpProtocol>();
+        ftp->set_optimistic(config_.optimistic_commands);
+        protocols_.push_back(std::move(ftp));
+    }
     if (config_.enable_telnet) protocols_.push_back(std::make_unique<TelnetProtocol>());
     if (config_.enable_ssh) protocols_.push_back(std::make_unique<SshProtocol>());
+
+    if (config_.enable_service) {
+        auto db = std::make_shared<ServiceProbeDb>();
+        if (db->load(config_.service_probe_file)) {
+            protocols_.push_back(std::make_unique<ServiceProtocol>(
+                std::move(db), config_.service_ports, config_.service_intensity, config_.service_max_probes));
+        }
+    }
+
+    // UDP 协议：--protocols 给出列表时按列表启用，否则按配置 udp.protocols
+    const auto& wanted = config_.custom_protocols;
+    const auto& udp_wanted = wanted.empty() ? config_.udp_protocols : wanted;
+    auto udp_enabled = [&](std::string_view name) {
+        return std::find(udp_wanted.begin(), udp_wanted.end(), name) != udp_wanted.end();
+    };
+    if (udp_enabled("DNS")) protocols_.push_back(std::make_unique<DnsVersionProtocol>());
+    if (udp_enabled("NTP")) protocols_.push_back(std::make_unique<NtpProtocol>());
+    if (udp_enabled("NTP_PRIVATE")) protocols_.push_back(std::make_unique<NtpPrivateProtocol>());
+    if (udp_enabled("SNMP")) protocols_.push_back(std::make_unique<SnmpProtocol>());
+    if (udp_enabled("SSDP")) protocols_.push_back(std::make_unique<SsdpProtocol>());
+
+    // 脚本协议：--protocols 给出列表时按列表启用，否则按定义中的 enabled
+    for (auto& program : load_probe_definitions(config_.probe_definition_file)) {
+        bool enabled = wanted.empty()
+            ? program->enabled
+            : std::find(wanted.begin(), wanted.end(), program->name) != wanted.end();
+        if (!enabled) continue;
+        bool duplicate = std::any_of(protocols_.begin(), protocols_.end(),
+            [&](const auto& p) { return p->name() == program->name; });
+        if (duplicate) {
+            LOG_CORE_ERROR("Probe definition {} clashes with an existing protocol, skipped", program->name);
+            continue;
+        }
+        protocols_.push_back(std::make_unique<ScriptedProtocol>(std::move(program)));
+    }
+
+    // 空闲催促：只对服务端先发言的协议、在其非默认端口上生效（即 --scan-all-ports 时）
+    static constexpr std::string_view kNudgeHttp = "GET / HTTP/1.0\r\n\r\n";
+    static constexpr std::string_view kNudgeCrlf = "\r\n";
+    std::string_view nudge = config_.idle_nudge_payload == "crlf" ? kNudgeCrlf : kNudgeHttp;
+    for (auto& p : protocols_) {
+        p->set_idle_nudge(config_.idle_nudge, nudge);
+    }
+
+    recv_rate_limit() = RecvRateLimit{config_.min_recv_rate, config_.recv_rate_window};
 }
 
 bool Scanner::is_protocol_enabled(const std::string& name) const {
@@ -86,7 +202,9 @@ bool Scanner::is_protocol_enabled(const std::string& name) const {
     if (name == "FTP") return config_.enable_ftp;
     if (name == "TELNET") return config_.enable_telnet;
     if (name == "SSH") return config_.enable_ssh;
-    return false;
+    if (name == "SERVICE") return config_.enable_service;
+    return std::any_of(protocols_.begin(), protocols_.end(),
+        [&](const auto& p) { return p->name() == name; });
 }
 
 void Scanner::start(const std::string& source_path) {
@@ -237,7 +355,10 @@ void Scanner::result_handler_thread() {
                         has_success = true;
                         protocol_success_counts_[pr.protocol]++;
                     }
+                    if (pr.budget == BudgetTrip::Bytes) budget_bytes_count_++;
+                    if (pr.budget == BudgetTrip::Rate) budget_rate_count_++;
                 }
+                if (!r.tarpit.empty()) tarpit_hosts_count_++;
             }
             if (has_success) {
                 successful_ips_++;
@@ -316,6 +437,37 @@ void Scanner::result_handler_thread() {
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time_);
             report_ofs_ << "\n总耗时: " << duration.count() << " ms\n";
         }
+        if (dns_prefetcher_) {
+            auto ps = dns_prefetcher_->stats();
+            report_ofs_ << "DNS 预取: 命中 " << ps.hits << ", 未命中 " << ps.misses
+                        << ", 窗口 " << ps.window << ", 平均时延 " << ps.avg_dns_ms << " ms\n";
+        }
+        if (port_scanner_) {
+            auto ps = port_scanner_->stats();
+            report_ofs_ << "端口预扫: 尝试 " << ps.attempts << ", 开放 " << ps.open
+                        << ", 拒绝 " << ps.refused << ", 超时 " << ps.filtered;
+            if (port_scanner_->syn_enabled()) {
+                report_ofs_ << ", SYN 发送 " << ps.syn_sent;
+            }
+            report_ofs_ << "\n";
+        }
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            if (budget_bytes_count_ > 0 || budget_rate_count_ > 0) {
+                report_ofs_ << "接收预算: 超量 " << budget_bytes_count_ << ", 慢速 " << budget_rate_count_ << "\n";
+            }
+            if (tarpit_hosts_count_ > 0) {
+                report_ofs_ << "Tarpit 主机: " << tarpit_hosts_count_ << "\n";
+            }
+        }
+        if (enrich_stage_) {
+            auto es = enrich_stage_->stats();
+            report_ofs_ << "结果后处理: " << es.items << " 条, 唤醒 " << es.batches << " 次\n";
+        }
+        auto& certs = CertificateCache::instance();
+        if (certs.size() > 0) {
+            report_ofs_ << "证书: 唯一 " << certs.size() << ", 引用 " << certs.references() << "\n";
+        }
         report_ofs_ << "============================================\n";
         report_ofs_.flush();
         report_ofs_.close();
@@ -325,7 +477,20 @@ void Scanner::result_handler_thread() {
             progress_manager_->clear_checkpoint();
         }
     }
-    
+
+    // 证书表：结果中只记录证书 ID，详细字段集中输出一次
+    auto& certs = CertificateCache::instance();
+    if (certs.size() > 0) {
+        std::error_code ec;
+        fs::create_directories(config_.output_dir, ec);
+        std::ofstream cert_ofs(config_.output_dir + "/certificates.txt", std::ios::out | std::ios::trunc);
+        if (cert_ofs.is_open()) {
+            certs.write_table(cert_ofs);
+        } else {
+            LOG_CORE_WARN("Failed to write certificate table to {}", config_.output_dir);
+        }
+    }
+
     LOG_CORE_INFO("Result handler thread finished");
 }
 
@@ -366,6 +531,7 @@ void Scanner::scan_loop() {
                         rep.target = { s->domain(), s->dns_result().ip, {}, 0 };
                         rep.protocols = s->protocol_results();
                         rep.total_time = config_.probe_timeout;
+                        rep.tarpit = s->tarpit_reason();
                         result_queue_.push(rep);
                         return true;
                     }
@@ -384,6 +550,9 @@ void Scanner::scan_loop() {
             if (quota == 0) break;
         }
 
+        // DNS 前瞻：在准入点之前提前解析目标
+        refill_dns_prefetch();
+
         // 创建新 session 并分配任务
         while (quota > 0) {
             // 检查最大并发会话数（如果有配置）
@@ -391,27 +560,8 @@ void Scanner::scan_loop() {
                 break;
             }
 
-            ScanTarget t;
-            {
-                std::lock_guard<std::mutex> lock(targets_mutex_);
-                if (targets_.empty()) {
-                    // 唤醒输入线程，告知可以继续插入
-                    targets_cv_.notify_one();
-                    break;
-                }
-                t = targets_.back();
-                targets_.pop_back();
-            }
-
-            auto sess = std::make_unique<ScanSession>(
-                t,
-                dns_resolver_ ? std::shared_ptr<IDnsResolver>(dns_resolver_.get(), [](IDnsResolver*){}) : nullptr,
-                config_.dns_timeout,
-                config_.probe_timeout,
-                config_.scan_all_ports ? ScanSession::ProbeMode::AllAvailable : ScanSession::ProbeMode::ProtocolDefaults,
-                protocols_
-            );
-            sess->set_only_success(config_.only_success);
+            auto sess = admit_session();
+            if (!sess) break;
 
             while (quota > 0 && sess->start_one_probe(protocols_, *scan_pool_, io_exec, config_.probe_timeout)) {
                 --quota;
@@ -429,7 +579,8 @@ void Scanner::scan_loop() {
             }
         }
         
-        bool all_done = input_done_ && targets_.empty() && sessions_.empty() && !has_pending;
+        bool all_done = input_done_ && targets_.empty() && sessions_.empty() && !has_pending &&
+                        !prefetch_pending();
         if (all_done) {
             break;
         }
@@ -437,22 +588,74 @@ void Scanner::scan_loop() {
         std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
     
+    if (dns_prefetcher_) {
+        auto ps = dns_prefetcher_->stats();
+        LOG_DNS_INFO("DNS prefetch: hits={} misses={} resolved={} failed={} window={} avg_dns={:.1f}ms rate={:.1f}/s",
+                     ps.hits, ps.misses, ps.resolved, ps.failed, ps.window, ps.avg_dns_ms, ps.admission_rate);
+    }
     LOG_CORE_INFO("Scan loop completed");
 }
 
+void Scanner::refill_dns_prefetch() {
+    if (!dns_prefetcher_) return;
+    size_t window = dns_prefetcher_->window();
+    size_t have = dns_prefetcher_->in_window();
+    if (have >= window) return;
+
+    std::vector<ScanTarget> batch;
+    {
+        std::lock_guard<std::mutex> lock(targets_mutex_);
+        while (have + batch.size() < window && !targets_.empty()) {
+            batch.push_back(std::move(targets_.back()));
+            targets_.pop_back();
+        }
+    }
+    // 唤醒输入线程，告知可以继续插入
+    targets_cv_.notify_one();
+
+    for (auto& t : batch) {
+        dns_prefetcher_->submit(std::move(t));
+    }
+}
+
+std::unique_ptr<ScanSession> Scanner::admit_session() {
+    if (!dns_prefetcher_) return nullptr;
+    PrefetchedTarget pt;
+    if (!dns_prefetcher_->try_take(pt)) return nullptr;
+
+    auto sess = std::make_unique<ScanSession>(
+        pt.target,
+        std::move(pt.dns),
+        config_.probe_timeout,
+        config_.scan_all_ports ? ScanSession::ProbeMode::AllAvailable : ScanSession::ProbeMode::ProtocolDefaults,
+        protocols_
+    );
+    sess->set_only_success(config_.only_success);
+    sess->set_tarpit_detection(config_.tarpit_detection);
+    sess->set_enrich_stage(enrich_stage_.get());
+    if (port_scanner_) {
+        sess->begin_port_sweep(*port_scanner_);
+    }
+    return sess;
+}
+
+bool Scanner::prefetch_pending() const {
+    return dns_prefetcher_ && !dns_prefetcher_->empty();
+}
+
 std::vector<ScanReport> Scanner::get_results(std::chrono::milliseconds timeout) {
     std::unique_lock<std::mutex> lock(reports_mutex_);
     
     if (timeout.count() > 0) {
         reports_cv_.wait_for(lock, timeout, [this]() {
-            return input_done_ && targets_.empty() && sessions_.empty();
+            return input_done_ && targets_.empty() && sessions_.empty() && !prefetch_pending();
         });
     } else if (timeout.count() == 0) {
         // 不等待，直接返回当前结果
     } else {
         // 无限等待
         reports_cv_.wait(lock, [this]() {
-            return input_done_ && targets_.empty() && sessions_.empty();
+            return input_done_ && targets_.empty() && sessions_.empty() && !prefetch_pending();
         });
     }
     
@@ -513,6 +716,7 @@ std::vector<ScanReport> Scanner::scan_domains(const std::vector<std::string>& do
                         rep.target = { s->domain(), s->dns_result().ip, {}, 0 };
                         rep.protocols = s->protocol_results();
                         rep.total_time = config_.probe_timeout;
+                        rep.tarpit = s->tarpit_reason();
                         result_queue_.push(rep);
                         return true;
                     }
@@ -531,6 +735,8 @@ std::vector<ScanReport> Scanner::scan_domains(const std::vector<std::string>& do
             if (quota == 0) break;
         }
 
+        refill_dns_prefetch();
+
         // 创建新 session 并分配任务
         while (quota > 0) {
             // 检查最大并发会话数（如果有配置）
@@ -538,22 +744,8 @@ std::vector<ScanReport> Scanner::scan_domains(const std::vector<std::string>& do
                 break;
             }
 
-            ScanTarget t;
-            {
-                std::lock_guard<std::mutex> lock(targets_mutex_);
-                if (targets_.empty()) break;
-                t = targets_.back();
-                targets_.pop_back();
-            }
-
-            auto sess = std::make_unique<ScanSession>(
-                t,
-                dns_resolver_ ? std::shared_ptr<IDnsResolver>(dns_resolver_.get(), [](IDnsResolver*){}) : nullptr,
-                config_.dns_timeout,
-                config_.probe_timeout,
-                config_.scan_all_ports ? ScanSession::ProbeMode::AllAvailable : ScanSession::ProbeMode::ProtocolDefaults,
-                protocols_
-            );            sess->set_only_success(config_.only_success);
+            auto sess = admit_session();
+            if (!sess) break;
             while (quota > 0 && sess->start_one_probe(protocols_, *scan_pool_, io_exec, config_.probe_timeout)) {
                 --quota;
             }
@@ -572,7 +764,7 @@ std::vector<ScanReport> Scanner::scan_domains(const std::vector<std::string>& do
             }
             if (!has_pending) {
                 std::lock_guard<std::mutex> lock(targets_mutex_);
-                if (targets_.empty() && sessions_.empty()) {
+                if (targets_.empty() && sessions_.empty() && !prefetch_pending()) {
                     break;
                 }
             }
@@ -0,0 +1,218 @@
+#include "scanner/network/syn_scanner.h"
+#include "scanner/common/logger.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <random>
+
+namespace scanner {
+
+namespace {
+
+constexpr std::uint8_t kTcpFin = 0x01;
+constexpr std::uint8_t kTcpSyn = 0x02;
+constexpr std::uint8_t kTcpRst = 0x04;
+constexpr std::uint8_t kTcpAck = 0x10;
+
+// 源端口取自内核临时端口范围（默认 32768-60999）之外，避免与正常连接冲突
+constexpr std::uint16_t kSourcePortBase = 61000;
+constexpr std::uint16_t kSourcePortSpan = 4096;
+
+constexpr std::size_t kTcpHeaderLen = 24;  // 20 字节基本头 + MSS 选项
+constexpr std::size_t kDrainBatch = 256;   // 单次可读通知最多处理的包数
+
+inline std::uint16_t load_be16(const unsigned char* p) {
+    return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline std::uint32_t load_be32(const unsigned char* p) {
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+}
+
+inline void store_be16(unsigned char* p, std::uint16_t v) {
+    p[0] = static_cast<unsigned char>(v >> 8);
+    p[1] = static_cast<unsigned char>(v);
+}
+
+inline void store_be32(unsigned char* p, std::uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+// TCP 校验和：伪首部（源/目的地址、协议号、TCP 长度）加 TCP 段的反码和
+std::uint16_t tcp_checksum(std::uint32_t src, std::uint32_t dst, const unsigned char* seg, std::size_t len) {
+    std::uint32_t sum = 0;
+    sum += (src >> 16) + (src & 0xffff);
+    sum += (dst >> 16) + (dst & 0xffff);
+    sum += IPPROTO_TCP;
+    sum += static_cast<std::uint32_t>(len);
+    for (std::size_t i = 0; i + 1 < len; i += 2) {
+        sum += load_be16(seg + i);
+    }
+    if (len & 1) sum += std::uint32_t(seg[len - 1]) << 8;
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return static_cast<std::uint16_t>(~sum);
+}
+
+} // namespace
+
+// =====================
+// 创建与生命周期
+// =====================
+
+std::unique_ptr<SynScanner> SynScanner::create(asio::io_context& ctx, ReplyHandler on_reply) {
+    int fd = ::socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd < 0) {
+        LOG_NETWORK_WARN("SYN scan unavailable (raw socket: {}), falling back to connect scan",
+                         std::strerror(errno));
+        return nullptr;
+    }
+    // 高速扫描时应答集中到达，放大接收缓冲减少丢包
+    int rcvbuf = 8 * 1024 * 1024;
+    (void)::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    return std::unique_ptr<SynScanner>(new SynScanner(ctx, fd, std::move(on_reply)));
+}
+
+SynScanner::SynScanner(asio::io_context& ctx, int fd, ReplyHandler on_reply)
+    : socket_(ctx, fd), on_reply_(std::move(on_reply)) {
+    std::random_device rd;
+    key_.k0 = (std::uint64_t(rd()) << 32) | rd();
+    key_.k1 = (std::uint64_t(rd()) << 32) | rd();
+}
+
+SynScanner::~SynScanner() {
+    stop();
+}
+
+void SynScanner::start() {
+    wait_readable();
+}
+
+void SynScanner::stop() {
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+}
+
+bool SynScanner::source_for(const asio::ip::address_v4& dst, asio::ip::address_v4& src) {
+    // 对 UDP 套接字调用 connect 只做路由选择，不发送任何数据
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(9);
+    to.sin_addr.s_addr = htonl(dst.to_uint());
+    sockaddr_in local{};
+    socklen_t len = sizeof(local);
+    bool ok = ::connect(fd, reinterpret_cast<sockaddr*>(&to), sizeof(to)) == 0 &&
+              ::getsockname(fd, reinterpret_cast<sockaddr*>(&local), &len) == 0;
+    ::close(fd);
+    if (ok) src = asio::ip::address_v4(ntohl(local.sin_addr.s_addr));
+    return ok;
+}
+
+// =====================
+// 发送
+// =====================
+
+SynScanner::Cookie SynScanner::cookie(std::uint32_t src, std::uint32_t dst, Port port) const {
+    unsigned char in[10];
+    store_be32(in, src);
+    store_be32(in + 4, dst);
+    store_be16(in + 8, port);
+    std::uint64_t h = siphash24(key_, in, sizeof(in));
+    return Cookie{static_cast<std::uint32_t>(h),
+                  static_cast<std::uint16_t>(kSourcePortBase + ((h >> 32) % kSourcePortSpan))};
+}
+
+bool SynScanner::send_syn(const asio::ip::address_v4& src, const asio::ip::address_v4& dst, Port port) {
+    auto c = cookie(src.to_uint(), dst.to_uint(), port);
+    return send_segment(src.to_uint(), dst.to_uint(), c.sport, port, c.seq, 0, kTcpSyn);
+}
+
+bool SynScanner::send_segment(std::uint32_t src, std::uint32_t dst, std::uint16_t sport, Port dport,
+                              std::uint32_t seq, std::uint32_t ack, std::uint8_t flags) {
+    // 未设置 IP_HDRINCL，IP 头由内核填写，这里只构造 TCP 段
+    unsigned char seg[kTcpHeaderLen] = {};
+    store_be16(seg, sport);
+    store_be16(seg + 2, dport);
+    store_be32(seg + 4, seq);
+    store_be32(seg + 8, ack);
+    seg[12] = static_cast<unsigned char>((kTcpHeaderLen / 4) << 4);
+    seg[13] = flags;
+    store_be16(seg + 14, (flags & kTcpRst) ? 0 : 1024);
+    // MSS 选项，使 SYN 与常见协议栈发出的一致
+    seg[20] = 2;
+    seg[21] = 4;
+    store_be16(seg + 22, 1460);
+    store_be16(seg + 16, tcp_checksum(src, dst, seg, sizeof(seg)));
+
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(dst);
+    ssize_t n = ::sendto(socket_.native_handle(), seg, sizeof(seg), 0,
+                         reinterpret_cast<sockaddr*>(&to), sizeof(to));
+    if (n != static_cast<ssize_t>(sizeof(seg))) {
+        return false;
+    }
+    if (flags & kTcpSyn) sent_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// =====================
+// 接收与校验
+// =====================
+
+void SynScanner::wait_readable() {
+    socket_.async_wait(asio::posix::stream_descriptor::wait_read,
+                       [this](const boost::system::error_code& ec) {
+                           if (ec) return;
+                           drain();
+                           wait_readable();
+                       });
+}
+
+void SynScanner::drain() {
+    unsigned char buf[1500];
+    for (std::size_t i = 0; i < kDrainBatch; ++i) {
+        ssize_t n = ::recv(socket_.native_handle(), buf, sizeof(buf), MSG_DONTWAIT);
+        if (n <= 0) return;
+        handle_packet(buf, static_cast<std::size_t>(n));
+    }
+}
+
+void SynScanner::handle_packet(const unsigned char* pkt, std::size_t len) {
+    // 原始套接字收到的是完整 IPv4 包，本机所有 TCP 流量都会经过这里，先做最便宜的过滤
+    if (len < 20 || (pkt[0] >> 4) != 4) return;
+    std::size_t ihl = std::size_t(pkt[0] & 0x0f) * 4;
+    if (ihl < 20 || len < ihl + 20) return;
+    const unsigned char* tcp = pkt + ihl;
+
+    std::uint8_t flags = tcp[13];
+    bool syn_ack = (flags & (kTcpSyn | kTcpAck)) == (kTcpSyn | kTcpAck);
+    bool rst = (flags & kTcpRst) != 0;
+    if (!syn_ack && !rst) return;
+    if (flags & kTcpFin) return;
+
+    std::uint16_t dport = load_be16(tcp + 2);
+    if (dport < kSourcePortBase || dport >= kSourcePortBase + kSourcePortSpan) return;
+
+    // 应答的源是探测目标，目的是本机
+    std::uint32_t target = load_be32(pkt + 12);
+    std::uint32_t local = load_be32(pkt + 16);
+    Port port = load_be16(tcp);
+    auto c = cookie(local, target, port);
+    if (dport != c.sport || load_be32(tcp + 8) != c.seq + 1) return;
+
+    if (syn_ack) {
+        // 拆除对端的半连接，不让它继续重传 SYN-ACK
+        send_segment(local, target, c.sport, port, c.seq + 1, 0, kTcpRst);
+    }
+    on_reply_(target, port, syn_ack);
+}
+
+} // namespace scanner
@@ -0,0 +1,133 @@
+#!/bin/bash
+
+# Probe Allocation / CPU Benchmark
+# Compares heap allocations and CPU time per probe between two scanner builds
+# (e.g. before/after a probe-layer change).
+#
+# Usage:
+#   tests/run_probe_alloc_benchmark.sh <scanner_before> <scanner_after>
+#
+# Environment:
+#   TARGET            IP to probe repeatedly (default 127.0.0.1)
+#   TARGET_COUNT      target lines in the larger run (default 2000)
+#   PROTOCOLS         protocols to probe (default FTP,SSH,TELNET)
+#   PORTS_PER_TARGET  probes per target for the chosen protocols (default 3)
+#
+# Point TARGET at a host running the chosen services to exercise full dialogs.
+# Each build runs twice, once with N targets and once with 2N targets. The
+# per-probe figures come from the difference between the two runs, which
+# cancels startup costs (config load, vendor patterns, thread pools).
+# malloc calls are counted with a tiny LD_PRELOAD shim compiled on the fly.
+# Compare runs with similar "OK probes" counts: failed and timed-out probes take
+# different code paths, so an overloaded local daemon skews the per-probe figures.
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <scanner_before> <scanner_after>"
+    exit 1
+fi
+
+BEFORE="$1"
+AFTER="$2"
+TARGET=${TARGET:-127.0.0.1}
+TARGET_COUNT=${TARGET_COUNT:-2000}
+PROTOCOLS=${PROTOCOLS:-FTP,SSH,TELNET}
+PORTS_PER_TARGET=${PORTS_PER_TARGET:-3}
+CONFIG_FILE="config/scanner_config.json"
+OUTPUT_DIR="tests/output/probe_alloc"
+SUMMARY_FILE="$OUTPUT_DIR/probe_alloc_benchmark_summary.txt"
+
+mkdir -p "$OUTPUT_DIR"
+
+# =====================
+# malloc 计数 shim
+# =====================
+SHIM_SRC="$OUTPUT_DIR/malloc_count.c"
+SHIM_LIB="$OUTPUT_DIR/malloc_count.so"
+cat > "$SHIM_SRC" <<'EOF'
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static atomic_ulong g_count;
+static void* (*real_malloc)(size_t);
+
+void* malloc(size_t n) {
+    if (!real_malloc) real_malloc = dlsym(RTLD_NEXT, "malloc");
+    atomic_fetch_add_explicit(&g_count, 1, memory_order_relaxed);
+    return real_malloc(n);
+}
+
+__attribute__((destructor)) static void report(void) {
+    const char* path = getenv("MALLOC_COUNT_FILE");
+    FILE* f = path ? fopen(path, "w") : NULL;
+    if (f) {
+        fprintf(f, "%lu\n", atomic_load(&g_count));
+        fclose(f);
+    }
+}
+EOF
+cc -O2 -shared -fPIC -o "$SHIM_LIB" "$SHIM_SRC" -ldl
+
+# =====================
+# 输入生成
+# =====================
+INPUT_N="$OUTPUT_DIR/targets_n.txt"
+INPUT_2N="$OUTPUT_DIR/targets_2n.txt"
+for _ in $(seq $((TARGET_COUNT / 2))); do echo "$TARGET"; done > "$INPUT_N"
+for _ in $(seq "$TARGET_COUNT"); do echo "$TARGET"; done > "$INPUT_2N"
+
+# 扫描器会回写厂商规则文件，使用副本避免改动仓库配置
+VENDOR_FILE="$OUTPUT_DIR/vendors.json"
+cp config/vendors.json "$VENDOR_FILE"
+
+# 运行一次，输出 "<mallocs> <cpu_seconds> <successful_probes>"
+run_once() {
+    local scanner="$1" input="$2" run_dir="$3"
+    rm -rf "$run_dir"
+    mkdir -p "$run_dir"
+    local count_file="$run_dir/malloc_count"
+    local TIMEFORMAT="%U %S"
+    local cpu
+    cpu=$( { time MALLOC_COUNT_FILE="$count_file" LD_PRELOAD="$PWD/$SHIM_LIB" "$scanner" \
+                --config "$CONFIG_FILE" \
+                --vendor-file "$VENDOR_FILE" \
+                --domains "$input" \
+                --scan \
+                --protocols "$PROTOCOLS" \
+                --output "$run_dir" \
+                --quiet \
+                > "$run_dir/run.log" 2>&1 || true; } 2>&1 )
+    local user sys
+    read -r user sys <<< "$cpu"
+    local ok
+    ok=$(awk '/^  [A-Z0-9]+: [0-9]+$/ { n += $2 } END { print n + 0 }' "$run_dir/scan_results.txt" 2>/dev/null || echo 0)
+    echo "$(cat "$count_file" 2>/dev/null || echo 0) $(awk -v u="$user" -v s="$sys" 'BEGIN { print u + s }') $ok"
+}
+
+echo "Probe Allocation Benchmark" > "$SUMMARY_FILE"
+echo "Generated: $(date)" >> "$SUMMARY_FILE"
+echo "Target: $TARGET x $TARGET_COUNT, protocols: $PROTOCOLS ($PORTS_PER_TARGET probes/target)" >> "$SUMMARY_FILE"
+echo "=========================================" >> "$SUMMARY_FILE"
+
+printf "%-10s %-18s %-18s %-18s\n" "Build" "mallocs/probe" "CPU us/probe" "OK probes (2N)" | tee -a "$SUMMARY_FILE"
+echo "-----------------------------------------------------------------" | tee -a "$SUMMARY_FILE"
+
+PROBES=$(( (TARGET_COUNT - TARGET_COUNT / 2) * PORTS_PER_TARGET ))
+
+for label in before after; do
+    if [ "$label" = "before" ]; then scanner="$BEFORE"; else scanner="$AFTER"; fi
+    read -r m1 c1 _ <<< "$(run_once "$scanner" "$INPUT_N" "$OUTPUT_DIR/${label}_n")"
+    read -r m2 c2 ok2 <<< "$(run_once "$scanner" "$INPUT_2N" "$OUTPUT_DIR/${label}_2n")"
+    allocs=$(awk -v a="$m1" -v b="$m2" -v p="$PROBES" 'BEGIN { printf "%.2f", (b - a) / p }')
+    cpu_us=$(awk -v a="$c1" -v b="$c2" -v p="$PROBES" 'BEGIN { printf "%.2f", (b - a) * 1000000 / p }')
+    printf "%-10s %-18s %-18s %-18s\n" "$label" "$allocs" "$cpu_us" "$ok2" | tee -a "$SUMMARY_FILE"
+done
+
+echo ""
+echo "Results saved to: $SUMMARY_FILE"
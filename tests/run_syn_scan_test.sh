@@ -0,0 +1,131 @@
+#!/bin/bash
+
+# SYN Scan Loopback Test
+# Runs the port pre-pass twice against the same target, once with kernel
+# connects and once with raw-socket SYN probes (--syn-scan), and checks that
+# both find the same open/refused ports and the same successful probes.
+#
+# Usage:
+#   tests/run_syn_scan_test.sh <scanner>
+#
+# Environment:
+#   TARGET        IP to scan (default 127.0.0.1)
+#   TARGET_COUNT  repeated target lines (default 50)
+#   PROTOCOLS     protocols to probe (default FTP,SSH,TELNET)
+#   LISTEN_PORTS  loopback ports to serve with a stub greeting listener when
+#                 nothing is listening there yet (default "21 22 23")
+#
+# Needs root or CAP_NET_RAW (docker run --cap-add NET_RAW ...). Without it the
+# scanner falls back to connect scan and the test reports SKIP.
+# The stub listeners make the test self-contained in an empty container; they
+# are only started on ports that are free and stopped on exit.
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <scanner>"
+    exit 1
+fi
+
+SCANNER="$1"
+TARGET=${TARGET:-127.0.0.1}
+TARGET_COUNT=${TARGET_COUNT:-50}
+PROTOCOLS=${PROTOCOLS:-FTP,SSH,TELNET}
+LISTEN_PORTS=${LISTEN_PORTS:-"21 22 23"}
+CONFIG_FILE="config/scanner_config.json"
+OUTPUT_DIR="tests/output/syn_scan"
+
+mkdir -p "$OUTPUT_DIR"
+
+# =====================
+# 桩监听
+# =====================
+STUB_PIDS=()
+cleanup() {
+    for pid in "${STUB_PIDS[@]}"; do kill "$pid" 2>/dev/null || true; done
+}
+trap cleanup EXIT
+
+for port in $LISTEN_PORTS; do
+    if (exec 3<>"/dev/tcp/$TARGET/$port") 2>/dev/null; then
+        continue
+    fi
+    python3 - "$TARGET" "$port" <<'EOF' &
+import socket, sys
+s = socket.socket()
+s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+s.bind((sys.argv[1], int(sys.argv[2])))
+s.listen(128)
+while True:
+    c, _ = s.accept()
+    try:
+        c.sendall(b"220 stub service ready\r\n")
+    finally:
+        c.close()
+EOF
+    STUB_PIDS+=($!)
+done
+sleep 0.5
+
+# =====================
+# 两种后端各运行一次
+# =====================
+INPUT="$OUTPUT_DIR/targets.txt"
+for _ in $(seq "$TARGET_COUNT"); do echo "$TARGET"; done > "$INPUT"
+
+VENDOR_FILE="$OUTPUT_DIR/vendors.json"
+cp config/vendors.json "$VENDOR_FILE"
+
+# 输出 "<open> <refused> <filtered> <OK probes>"，并把 SYN 是否真正启用写入 <run_dir>/syn
+run_once() {
+    local run_dir="$1"; shift
+    rm -rf "$run_dir"
+    mkdir -p "$run_dir"
+    "$SCANNER" \
+        --config "$CONFIG_FILE" \
+        --vendor-file "$VENDOR_FILE" \
+        --domains "$INPUT" \
+        --scan \
+        --protocols "$PROTOCOLS" \
+        --output "$run_dir" \
+        --quiet \
+        "$@" > "$run_dir/run.log" 2>&1 || true
+    local line
+    line=$(grep '^端口预扫:' "$run_dir/scan_results.txt" || true)
+    if [[ "$line" == *"SYN 发送"* ]]; then echo yes > "$run_dir/syn"; else echo no > "$run_dir/syn"; fi
+    local ok
+    ok=$(awk '/^  [A-Z0-9]+: [0-9]+$/ { n += $2 } END { print n + 0 }' "$run_dir/scan_results.txt" 2>/dev/null || echo 0)
+    echo "$line" | awk -v ok="$ok" '{
+        for (i = 1; i <= NF; i++) {
+            if ($i == "开放") open = $(i + 1)
+            if ($i == "拒绝") refused = $(i + 1)
+            if ($i == "超时") filtered = $(i + 1)
+        }
+        gsub(",", "", open); gsub(",", "", refused); gsub(",", "", filtered)
+        print open + 0, refused + 0, filtered + 0, ok
+    }'
+}
+
+read -r c_open c_refused c_filtered c_ok <<< "$(run_once "$OUTPUT_DIR/connect")"
+read -r s_open s_refused s_filtered s_ok <<< "$(run_once "$OUTPUT_DIR/syn" --syn-scan)"
+
+printf "%-10s %-8s %-8s %-9s %-9s\n" "Backend" "open" "refused" "filtered" "OK probes"
+printf "%-10s %-8s %-8s %-9s %-9s\n" "connect" "$c_open" "$c_refused" "$c_filtered" "$c_ok"
+printf "%-10s %-8s %-8s %-9s %-9s\n" "syn" "$s_open" "$s_refused" "$s_filtered" "$s_ok"
+
+if [ "$(cat "$OUTPUT_DIR/syn/syn")" != "yes" ]; then
+    echo "SKIP: raw sockets unavailable (needs root or CAP_NET_RAW)"
+    exit 0
+fi
+
+if [ "$s_open" -eq 0 ]; then
+    echo "FAIL: SYN scan found no open ports"
+    exit 1
+fi
+if [ "$c_open" != "$s_open" ] || [ "$c_refused" != "$s_refused" ] || [ "$c_ok" != "$s_ok" ]; then
+    echo "FAIL: connect and SYN pre-pass disagree"
+    exit 1
+fi
+echo "PASS"